@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <QDateTime>
+#include <QString>
+
+#include "FastDecode.hpp"
+
+// Compares the per-trackpoint cost of decoding the fields of a trackpoint the way the parser used to do it
+// (std::string copies + std::stod/std::stoi + QDateTime::fromString) with the decoders from FastDecode.hpp.
+
+struct RawTrackpoint {
+	std::string time;
+	std::string latitude;
+	std::string longitude;
+	std::string altitude;
+	std::string distance;
+	std::string heartRate;
+};
+
+static std::vector<RawTrackpoint> GenerateRawTrackpoints(std::size_t count) {
+	std::vector<RawTrackpoint> result;
+	result.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		RawTrackpoint tp;
+		std::int64_t const secondOfDay = static_cast<std::int64_t>(i % 86400);
+		std::ostringstream time;
+		time << "2023-05-" << std::setw(2) << std::setfill('0') << (1 + (i / 86400) % 28) << "T" << std::setw(2) << (secondOfDay / 3600) << ":" << std::setw(2) << ((secondOfDay / 60) % 60) << ":" << std::setw(2) << (secondOfDay % 60) << ".000Z";
+		tp.time = time.str();
+		tp.latitude = std::to_string(48.137154 + static_cast<double>(i) * 1e-6);
+		tp.longitude = std::to_string(11.576124 + static_cast<double>(i) * 1e-6);
+		tp.altitude = std::to_string(519.4 + static_cast<double>(i % 100) * 0.1);
+		tp.distance = std::to_string(static_cast<double>(i) * 2.75);
+		tp.heartRate = std::to_string(100 + (i % 80));
+		result.push_back(std::move(tp));
+	}
+	return result;
+}
+
+template<typename Callable>
+static double MeasureNanosecondsPerPoint(std::vector<RawTrackpoint> const& points, std::size_t repetitions, Callable&& decode) {
+	double best = std::numeric_limits<double>::max();
+	for (std::size_t r = 0; r < repetitions; ++r) {
+		auto const timeStart = std::chrono::steady_clock::now();
+		for (auto const& tp : points) {
+			decode(tp);
+		}
+		auto const timeEnd = std::chrono::steady_clock::now();
+		double const ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd - timeStart).count()) / static_cast<double>(points.size());
+		best = std::min(best, ns);
+	}
+	return best;
+}
+
+int main(int argc, char* argv[]) {
+	std::size_t const count = (argc > 1) ? std::stoull(argv[1]) : 1000000;
+	std::size_t const repetitions = 5;
+	std::cout << "Generating " << count << " trackpoints..." << std::endl;
+	auto const points = GenerateRawTrackpoints(count);
+
+	double checksumOld = 0.0;
+	double const nsOld = MeasureNanosecondsPerPoint(points, repetitions, [&](RawTrackpoint const& tp) {
+		QDateTime const dateTime = QDateTime::fromString(QString::fromStdString(tp.time), Qt::ISODateWithMs);
+		if (dateTime.toString("zzz").compare("000") != 0) return;
+		checksumOld += static_cast<double>(dateTime.toMSecsSinceEpoch() % 1000000);
+		checksumOld += std::stod(std::string(tp.latitude));
+		checksumOld += std::stod(std::string(tp.longitude));
+		checksumOld += std::stod(std::string(tp.altitude));
+		checksumOld += std::stod(std::string(tp.distance));
+		checksumOld += std::stoi(std::string(tp.heartRate));
+	});
+
+	double checksumNew = 0.0;
+	double const nsNew = MeasureNanosecondsPerPoint(points, repetitions, [&](RawTrackpoint const& tp) {
+		auto const timeMs = DecodeIsoTimestamp(tp.time);
+		if (!timeMs.has_value() || (timeMs.value() % 1000) != 0) return;
+		checksumNew += static_cast<double>(timeMs.value() % 1000000);
+		double value = 0.0;
+		int heartRate = 0;
+		DecodeDouble(tp.latitude, value);
+		checksumNew += value;
+		DecodeDouble(tp.longitude, value);
+		checksumNew += value;
+		DecodeDouble(tp.altitude, value);
+		checksumNew += value;
+		DecodeDouble(tp.distance, value);
+		checksumNew += value;
+		DecodeInteger(tp.heartRate, heartRate);
+		checksumNew += heartRate;
+	});
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "stod/stoi + QDateTime: " << nsOld << " ns per trackpoint (checksum " << checksumOld << ")" << std::endl;
+	std::cout << "FastDecode:            " << nsNew << " ns per trackpoint (checksum " << checksumNew << ")" << std::endl;
+	std::cout << "Speedup:               " << (nsOld / nsNew) << "x" << std::endl;
+	return (checksumOld == checksumNew) ? 0 : 1;
+}
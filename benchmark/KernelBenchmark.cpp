@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "SeriesKernels.hpp"
+
+// Compares the variants of the element-wise kernels from SeriesKernels.hpp (see KernelInstructionSet) on synthetic series
+// and checks that they give bit-identical results.
+
+struct Series {
+	std::vector<std::int64_t> timeMs;
+	std::vector<double> distanceMeters;
+	std::vector<std::uint64_t> distanceValidity;
+	std::vector<double> latitudeDegrees;
+	std::vector<double> longitudeDegrees;
+	std::vector<std::uint64_t> positionValidity;
+	std::vector<std::uint8_t> heartRateBpm;
+	std::vector<std::uint64_t> heartRateValidity;
+	std::vector<double> speed;
+};
+
+// One sample per second with the odd pause, a few percent of the distances, positions and heart rates missing.
+// The positions wander around with steps of a few meters, with the odd jump of several hundred kilometers as after a GPS reset.
+static Series GenerateSeries(std::size_t count) {
+	Series result;
+	result.timeMs.resize(count);
+	result.distanceMeters.resize(count);
+	result.heartRateBpm.resize(count);
+	result.distanceValidity.resize((count + 63) / 64, 0);
+	result.heartRateValidity.resize((count + 63) / 64, 0);
+	result.latitudeDegrees.resize(count);
+	result.longitudeDegrees.resize(count);
+	result.positionValidity.resize((count + 63) / 64, 0);
+	double latitudeDegrees = 48.1;
+	double longitudeDegrees = 11.5;
+	std::uint32_t random = 12345;
+	std::int64_t timeMs = 1684929600000;
+	double distanceMeters = 0.0;
+	for (std::size_t i = 0; i < count; ++i) {
+		random = random * 1664525u + 1013904223u;
+		timeMs += ((random >> 8) % 500 == 0) ? 0 : 1000;
+		distanceMeters += ((random >> 12) % 100 < 10) ? 0.5 : 3.0;
+		result.timeMs[i] = timeMs;
+		result.distanceMeters[i] = distanceMeters;
+		result.heartRateBpm[i] = static_cast<std::uint8_t>(100 + (random >> 16) % 80);
+		if ((random >> 20) % 100 >= 3) result.distanceValidity[i / 64] |= std::uint64_t(1) << (i % 64);
+		if ((random >> 24) % 100 >= 3) result.heartRateValidity[i / 64] |= std::uint64_t(1) << (i % 64);
+		latitudeDegrees += (static_cast<double>((random >> 4) % 64) - 31.5) * 1e-6;
+		longitudeDegrees += (static_cast<double>((random >> 10) % 64) - 31.5) * 1.5e-6;
+		if ((random >> 3) % 100000 == 0) latitudeDegrees = -latitudeDegrees;
+		result.latitudeDegrees[i] = latitudeDegrees;
+		result.longitudeDegrees[i] = longitudeDegrees;
+		if ((random >> 27) % 100 >= 3) result.positionValidity[i / 64] |= std::uint64_t(1) << (i % 64);
+	}
+	return result;
+}
+
+template<typename Callable>
+static double MeasureNanosecondsPerElement(std::size_t count, std::size_t repetitions, Callable&& run) {
+	double best = std::numeric_limits<double>::max();
+	for (std::size_t r = 0; r < repetitions; ++r) {
+		auto const timeStart = std::chrono::steady_clock::now();
+		run();
+		auto const timeEnd = std::chrono::steady_clock::now();
+		best = std::min(best, static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd - timeStart).count()) / static_cast<double>(count));
+	}
+	return best;
+}
+
+int main(int argc, char* argv[]) {
+	std::size_t const count = (argc > 1) ? std::stoull(argv[1]) : 10000000;
+	std::size_t const repetitions = 5;
+	std::cout << "Generating " << count << " samples..." << std::endl;
+	Series series = GenerateSeries(count);
+	std::size_t const rows = count - 1;
+	series.speed.resize(rows);
+	SetKernelInstructionSet(KernelInstructionSet::Scalar);
+	ComputeSpeedKernel(series.timeMs, series.distanceMeters, series.distanceValidity, 1.0, series.speed);
+
+	std::vector<KernelInstructionSet> instructionSets = { KernelInstructionSet::Scalar };
+	if (GetBestKernelInstructionSet() != KernelInstructionSet::Scalar) {
+		instructionSets.push_back(GetBestKernelInstructionSet());
+	}
+	else {
+		std::cout << "The CPU supports no vectorized variant, only the scalar one is measured." << std::endl;
+	}
+
+	struct Kernel {
+		char const* name;
+		std::function<void(std::vector<double>&)> run;
+	};
+	std::vector<Kernel> const kernels = {
+		{ "Speed", [&](std::vector<double>& output) { ComputeSpeedKernel(series.timeMs, series.distanceMeters, series.distanceValidity, 1.0, output); } },
+		{ "GPS speed", [&](std::vector<double>& output) { ComputePositionSpeedKernel(series.timeMs, series.latitudeDegrees, series.longitudeDegrees, series.positionValidity, 1.0, output); } },
+		{ "m/s to km/h", [&](std::vector<double>& output) { ScaleKernel(series.speed, 3.6, output); } },
+		{ "Pace", [&](std::vector<double>& output) { SpeedToPaceKernel(series.speed, output); } },
+		{ "Heart rate", [&](std::vector<double>& output) { ValidBytesToDoubleKernel(std::span<std::uint8_t const>(series.heartRateBpm.data(), rows), series.heartRateValidity, output); } },
+	};
+
+	bool isIdentical = true;
+	std::cout << std::fixed << std::setprecision(2);
+	for (auto const& kernel : kernels) {
+		std::vector<double> reference;
+		double scalarNs = 0.0;
+		for (auto const instructionSet : instructionSets) {
+			SetKernelInstructionSet(instructionSet);
+			std::vector<double> output(rows);
+			double const ns = MeasureNanosecondsPerElement(rows, repetitions, [&]() { kernel.run(output); });
+			std::cout << std::left << std::setw(12) << kernel.name << std::setw(8) << GetKernelInstructionSetName(instructionSet) << std::right << std::setw(8) << ns << " ns per sample";
+			if (instructionSet == KernelInstructionSet::Scalar) {
+				scalarNs = ns;
+				reference = std::move(output);
+			}
+			else {
+				bool const isSame = std::memcmp(reference.data(), output.data(), rows * sizeof(double)) == 0;
+				isIdentical = isIdentical && isSame;
+				std::cout << ", " << (scalarNs / ns) << "x" << (isSame ? "" : " (results differ!)");
+			}
+			std::cout << std::endl;
+		}
+	}
+	SetKernelInstructionSet(GetBestKernelInstructionSet());
+	return isIdentical ? 0 : 1;
+}
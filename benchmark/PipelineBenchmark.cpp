@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include <QList>
+#include <QPointF>
+
+#include "ActivityComparison.hpp"
+#include "Decimation.hpp"
+#include "DerivedSeries.hpp"
+#include "FastDecode.hpp"
+#include "MappedFileString.hpp"
+#include "Parser.hpp"
+#include "Resampler.hpp"
+#include "SeriesFilters.hpp"
+
+// Times every stage from a TCX file to the points handed to the chart, on synthetic files of the given sizes:
+// loading the file, parsing it, resampling, speed, every filter and building (and decimating) a chart series the way the viewer does.
+// Every stage is run several times and the best time is reported, together with its throughput. The peak memory is that of the whole run.
+
+struct BenchmarkOptions {
+	std::vector<std::size_t> pointCounts = { 1000, 100000, 1000000 };
+	std::size_t lapCount = 1;
+	bool allFields = true;
+	std::int64_t sampleIntervalMs = 1000;
+	bool irregularSampling = false;
+	unsigned int threadCount = 0;
+	std::size_t repetitions = 3;
+	std::size_t windowSize = 30;
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	bool keepFiles = false;
+};
+
+static void PrintUsage(char const* executable) {
+	std::cout << "Usage: " << executable << " [options]" << std::endl;
+	std::cout << "Generates synthetic TCX files and times loading, parsing and analysing them." << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -n, --points <n,...>    Numbers of trackpoints of the generated files (default: 1000,100000,1000000)." << std::endl;
+	std::cout << "  -l, --laps <n>          Number of laps the trackpoints are split into (default: 1)." << std::endl;
+	std::cout << "      --minimal           Only write time and distance, instead of all fields incl. position, heart rate, cadence and power." << std::endl;
+	std::cout << "      --sample-ms <ms>    Time between two generated trackpoints (default: 1000)." << std::endl;
+	std::cout << "      --irregular         Sample every 1 to 8 seconds like devices with smart recording, instead." << std::endl;
+	std::cout << "  -j, --threads <n>       Threads of the parser (default: one per hardware thread)." << std::endl;
+	std::cout << "  -r, --repetitions <n>   Runs per stage, the best one counts (default: 3)." << std::endl;
+	std::cout << "  -w, --window <n>        Window size of the filters in samples (default: 30)." << std::endl;
+	std::cout << "  -d, --directory <dir>   Where to write the generated files (default: the temporary directory)." << std::endl;
+	std::cout << "      --keep              Do not delete the generated files afterwards." << std::endl;
+	std::cout << "  -h, --help              Show this help." << std::endl;
+}
+
+static bool ParseArguments(int argc, char* argv[], BenchmarkOptions& options) {
+	auto const decodePositive = [](std::string_view text, std::size_t& value) {
+		int decoded = 0;
+		if (!DecodeInteger(text, decoded) || decoded < 1) return false;
+		value = static_cast<std::size_t>(decoded);
+		return true;
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		std::string const argument = argv[i];
+		bool const hasValue = (i + 1) < argc;
+		std::size_t value = 0;
+		if (argument == "-h" || argument == "--help") {
+			return false;
+		}
+		else if ((argument == "-n" || argument == "--points") && hasValue) {
+			options.pointCounts.clear();
+			std::string const list = argv[++i];
+			std::size_t begin = 0;
+			while (begin <= list.size()) {
+				std::size_t const end = std::min(list.find(',', begin), list.size());
+				if (!decodePositive(std::string_view(list).substr(begin, end - begin), value)) {
+					std::cerr << "Error: Invalid number of points in '" << list << "'!" << std::endl;
+					return false;
+				}
+				options.pointCounts.push_back(value);
+				begin = end + 1;
+			}
+		}
+		else if ((argument == "-l" || argument == "--laps") && hasValue) {
+			if (!decodePositive(argv[++i], options.lapCount)) {
+				std::cerr << "Error: Invalid number of laps '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+		}
+		else if (argument == "--minimal") {
+			options.allFields = false;
+		}
+		else if (argument == "--sample-ms" && hasValue) {
+			if (!decodePositive(argv[++i], value)) {
+				std::cerr << "Error: Invalid sample interval '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+			options.sampleIntervalMs = static_cast<std::int64_t>(value);
+		}
+		else if (argument == "--irregular") {
+			options.irregularSampling = true;
+		}
+		else if ((argument == "-j" || argument == "--threads") && hasValue) {
+			if (!decodePositive(argv[++i], value)) {
+				std::cerr << "Error: Invalid number of threads '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+			options.threadCount = static_cast<unsigned int>(value);
+		}
+		else if ((argument == "-r" || argument == "--repetitions") && hasValue) {
+			if (!decodePositive(argv[++i], options.repetitions)) {
+				std::cerr << "Error: Invalid number of repetitions '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+		}
+		else if ((argument == "-w" || argument == "--window") && hasValue) {
+			if (!decodePositive(argv[++i], options.windowSize)) {
+				std::cerr << "Error: Invalid window size '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+		}
+		else if ((argument == "-d" || argument == "--directory") && hasValue) {
+			options.directory = argv[++i];
+		}
+		else if (argument == "--keep") {
+			options.keepFiles = true;
+		}
+		else {
+			std::cerr << "Error: Unknown or incomplete option '" << argument << "'!" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Peak resident set size of this process so far, in bytes. It cannot be reset, so with several sizes it is the maximum over all of them.
+static std::size_t GetPeakRssBytes() {
+#ifdef _MSC_VER
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return static_cast<std::size_t>(counters.PeakWorkingSetSize);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+	return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// A run through a park: position, altitude and heart rate wander around smoothly, the speed varies between 2.5 and 3.5 m/s.
+// Written through a buffer of 1 MB, as files with millions of trackpoints get several GB large.
+static void GenerateTcxFile(std::filesystem::path const& file, std::size_t pointCount, BenchmarkOptions const& options) {
+	std::ofstream out(file, std::ios::binary);
+	if (!out) {
+		throw std::runtime_error("Failed to open '" + file.string() + "' for writing!");
+	}
+
+	std::string buffer;
+	buffer.reserve(1 << 20);
+	auto const flush = [&]() {
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		buffer.clear();
+	};
+
+	std::int64_t const startTimeMs = 1684929600000; // 2023-05-24T12:00:00Z
+	buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	buffer += "<TrainingCenterDatabase xmlns=\"http://www.garmin.com/xmlschemas/TrainingCenterDatabase/v2\" xmlns:ns3=\"http://www.garmin.com/xmlschemas/ActivityExtension/v2\">\n";
+	buffer += "<Activities>\n<Activity Sport=\"Running\">\n<Id>" + EncodeIsoTimestamp(startTimeMs) + "</Id>\n";
+
+	std::size_t const pointsPerLap = std::max<std::size_t>((pointCount + options.lapCount - 1) / options.lapCount, 1);
+	std::uint32_t random = 12345;
+	std::int64_t timeMs = startTimeMs;
+	double distanceMeters = 0.0;
+	char line[512];
+	for (std::size_t i = 0; i < pointCount; ++i) {
+		if ((i % pointsPerLap) == 0) {
+			if (i > 0) buffer += "</Track>\n</Lap>\n";
+			buffer += "<Lap StartTime=\"" + EncodeIsoTimestamp(timeMs) + "\">\n<Track>\n";
+		}
+
+		double const t = static_cast<double>(i);
+		int length = 0;
+		if (options.allFields) {
+			length = std::snprintf(line, sizeof(line),
+				"<Trackpoint><Time>%s</Time><Position><LatitudeDegrees>%.7f</LatitudeDegrees><LongitudeDegrees>%.7f</LongitudeDegrees></Position>"
+				"<AltitudeMeters>%.1f</AltitudeMeters><DistanceMeters>%.2f</DistanceMeters><HeartRateBpm><Value>%d</Value></HeartRateBpm><Cadence>%d</Cadence>"
+				"<Extensions><ns3:TPX><ns3:Watts>%d</ns3:Watts></ns3:TPX></Extensions></Trackpoint>\n",
+				EncodeIsoTimestamp(timeMs).c_str(), 48.137154 + 0.005 * std::sin(t * 1e-3), 11.576124 + 0.005 * std::cos(t * 1e-3),
+				519.4 + 10.0 * std::sin(t * 1e-2), distanceMeters, 140 + static_cast<int>(20.0 * std::sin(t * 3e-3)), 85 + static_cast<int>(i % 5), 250 + static_cast<int>(i % 50));
+		}
+		else {
+			length = std::snprintf(line, sizeof(line), "<Trackpoint><Time>%s</Time><DistanceMeters>%.2f</DistanceMeters></Trackpoint>\n", EncodeIsoTimestamp(timeMs).c_str(), distanceMeters);
+		}
+		buffer.append(line, static_cast<std::size_t>(length));
+		if (buffer.size() > (1 << 20) - sizeof(line)) flush();
+
+		std::int64_t stepMs = options.sampleIntervalMs;
+		if (options.irregularSampling) {
+			random = random * 1664525u + 1013904223u;
+			stepMs = 1000 * (1 + static_cast<std::int64_t>((random >> 16) % 8));
+		}
+		timeMs += stepMs;
+		distanceMeters += (3.0 + 0.5 * std::sin(t * 1e-2)) * (static_cast<double>(stepMs) / 1000.0);
+	}
+	if (pointCount > 0) buffer += "</Track>\n</Lap>\n";
+	buffer += "</Activity>\n</Activities>\n</TrainingCenterDatabase>\n";
+	flush();
+	if (!out) {
+		throw std::runtime_error("Failed to write '" + file.string() + "'!");
+	}
+}
+
+// Best wall clock time of all repetitions in seconds
+template<typename Callable>
+static double MeasureBestSeconds(std::size_t repetitions, Callable&& run) {
+	double best = std::numeric_limits<double>::max();
+	for (std::size_t r = 0; r < repetitions; ++r) {
+		auto const timeStart = std::chrono::steady_clock::now();
+		run();
+		auto const timeEnd = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double>(timeEnd - timeStart).count());
+	}
+	return best;
+}
+
+static void PrintStage(char const* name, double seconds, std::size_t points, std::uintmax_t bytes) {
+	std::cout << "  " << std::left << std::setw(16) << name << std::right << std::setw(10) << std::setprecision(3) << (seconds * 1000.0) << " ms";
+	std::cout << std::setw(10) << std::setprecision(2) << (static_cast<double>(points) / seconds / 1e6) << " Mpoints/s";
+	if (bytes > 0) {
+		std::cout << std::setw(10) << std::setprecision(1) << (static_cast<double>(bytes) / seconds / (1024.0 * 1024.0)) << " MB/s";
+	}
+	std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	BenchmarkOptions options;
+	if (!ParseArguments(argc, argv, options)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	std::cout << std::fixed;
+	double checksum = 0.0;
+	for (std::size_t const pointCount : options.pointCounts) {
+		std::filesystem::path const file = options.directory / ("PipelineBenchmark-" + std::to_string(pointCount) + ".tcx");
+		auto const timeStart = std::chrono::steady_clock::now();
+		GenerateTcxFile(file, pointCount, options);
+		std::uintmax_t const fileSize = std::filesystem::file_size(file);
+		std::cout << pointCount << " trackpoints in " << options.lapCount << " laps, " << std::setprecision(1) << (static_cast<double>(fileSize) / (1024.0 * 1024.0)) << " MB"
+			<< " (generated in " << std::setprecision(2) << std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count() << "s):" << std::endl;
+
+		// Touch every page, otherwise only creating the mapping would be measured
+		double const loadSeconds = MeasureBestSeconds(options.repetitions, [&]() {
+			MappedFileString const content(file.string());
+			std::string_view const view = content.GetView();
+			std::uint64_t sum = 0;
+			for (std::size_t i = 0; i < view.size(); i += 4096) sum += static_cast<unsigned char>(view[i]);
+			checksum += static_cast<double>(sum);
+		});
+		PrintStage("Load", loadSeconds, pointCount, fileSize);
+
+		Track track;
+		double const parseSeconds = MeasureBestSeconds(options.repetitions, [&]() {
+			Parser parser(file, false, ParserBackend::Streaming, options.threadCount);
+			track = parser.TakeTrack();
+		});
+		PrintStage("Parse", parseSeconds, pointCount, fileSize);
+
+		Track resampledTrack;
+		double const resampleSeconds = MeasureBestSeconds(options.repetitions, [&]() {
+			Resample(track, ResampleOptions(), resampledTrack);
+		});
+		PrintStage("Resample", resampleSeconds, track.Size(), 0);
+
+		std::size_t const rowCount = (resampledTrack.Size() > 0) ? (resampledTrack.Size() - 1) : 0;
+		std::vector<double> speed(rowCount);
+		double const speedSeconds = MeasureBestSeconds(options.repetitions, [&]() {
+			ComputeSpeed(resampledTrack, speed, false);
+		});
+		PrintStage("Speed", speedSeconds, rowCount, 0);
+
+		std::vector<double> avgSpeed(rowCount);
+		SeriesFilter filter;
+		SeriesOptions filterOptions;
+		filterOptions.windowSize = static_cast<int>(options.windowSize);
+		filterOptions.cutoffMax = 250.0;
+		for (int type = 0; type < static_cast<int>(FilterType::COUNT); ++type) {
+			filterOptions.filterType = static_cast<FilterType>(type);
+			double const filterSeconds = MeasureBestSeconds(options.repetitions, [&]() {
+				filter.Apply(speed, filterOptions, avgSpeed);
+			});
+			PrintStage(GetFilterTypeName(filterOptions.filterType), filterSeconds, rowCount, 0);
+		}
+
+		DerivedSeries derivedSeries;
+		derivedSeries.Compute(track, DerivationOptions());
+		AlignmentAxes axes;
+		double const axesSeconds = MeasureBestSeconds(options.repetitions, [&]() {
+			axes.Compute(derivedSeries);
+			checksum += axes.Get(AlignmentMode::Distance)->back();
+		});
+		PrintStage("Alignment axes", axesSeconds, derivedSeries.Size(), 0);
+
+		// The same as the viewer does for every series: drop missing values, decimate for a chart of 2000 pixels and build the points of the QXYSeries
+		auto const& timeMs = resampledTrack.GetTimeMs();
+		std::vector<std::size_t> selected;
+		double const seriesSeconds = MeasureBestSeconds(options.repetitions, [&]() {
+			std::vector<double> x;
+			std::vector<double> y;
+			x.reserve(rowCount);
+			y.reserve(rowCount);
+			for (std::size_t i = 0; i < rowCount; ++i) {
+				if (std::isnan(avgSpeed[i])) continue;
+				x.push_back(static_cast<double>(timeMs[i]));
+				y.push_back(avgSpeed[i]);
+			}
+			DecimateLttb(x, y, 4000, selected);
+			QList<QPointF> points;
+			points.reserve(static_cast<qsizetype>(selected.size()));
+			for (std::size_t const index : selected) {
+				points.append(QPointF(x[index], y[index]));
+			}
+			checksum += static_cast<double>(points.size());
+		});
+		PrintStage("Chart series", seriesSeconds, rowCount, 0);
+
+		if (!options.keepFiles) {
+			std::error_code error;
+			std::filesystem::remove(file, error);
+		}
+	}
+	std::cout << "Peak RSS: " << std::setprecision(1) << (static_cast<double>(GetPeakRssBytes()) / (1024.0 * 1024.0)) << " MB (the maximum over all sizes, run a single one to get its own)" << std::endl;
+	std::cout << "(checksum " << std::setprecision(0) << checksum << ")" << std::endl;
+	return 0;
+}
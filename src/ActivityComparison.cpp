@@ -0,0 +1,189 @@
+#include "ActivityComparison.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+#include "SeriesKernels.hpp"
+#include "Trace.hpp"
+
+static bool HasDistance(Track const& track, std::size_t begin, std::size_t end) {
+	auto const& hasDistance = track.GetDistanceValidity();
+	for (std::size_t i = begin; i < end; ++i) {
+		if (hasDistance.Test(i)) return true;
+	}
+	return false;
+}
+
+// The distance axis in km of the rows [begin, end) of one activity, starting at startMeters. Returns the distance in meters at its end.
+static double ComputeRecordedDistance(Track const& track, std::size_t begin, std::size_t end, double startMeters, std::vector<double>& x) {
+	auto const& distanceMeters = track.GetDistanceMeters();
+	auto const& hasDistance = track.GetDistanceValidity();
+	bool isFirst = true;
+	double offsetMeters = 0.0;
+	double lastMeters = startMeters;
+	for (std::size_t i = begin; i < end; ++i) {
+		if (hasDistance.Test(i)) {
+			if (isFirst) {
+				offsetMeters = startMeters - distanceMeters[i];
+				isFirst = false;
+			}
+			// Resampling interpolates, but devices may still let the distance jitter backwards a bit
+			lastMeters = std::max(lastMeters, distanceMeters[i] + offsetMeters);
+		}
+		x[i] = lastMeters / 1000.0;
+	}
+	return lastMeters;
+}
+
+// Same as above, for an activity without any recorded distance, e.g. from a device that only logs GPS.
+static double ComputePositionDistance(Track const& track, std::size_t begin, std::size_t end, double startMeters, std::vector<double>& x) {
+	auto const& latitudeDegrees = track.GetLatitudeDegrees();
+	auto const& longitudeDegrees = track.GetLongitudeDegrees();
+	auto const& hasPosition = track.GetPositionValidity();
+	bool isFirst = true;
+	std::size_t lastPosition = begin;
+	double meters = startMeters;
+	for (std::size_t i = begin; i < end; ++i) {
+		if (hasPosition.Test(i)) {
+			if (!isFirst) {
+				meters += HaversineMeters(latitudeDegrees[lastPosition], longitudeDegrees[lastPosition], latitudeDegrees[i], longitudeDegrees[i]);
+			}
+			isFirst = false;
+			lastPosition = i;
+		}
+		x[i] = meters / 1000.0;
+	}
+	return meters;
+}
+
+void AlignmentAxes::Compute(DerivedSeries const& derivedSeries) {
+	TRACE_SCOPE("Alignment axes");
+	Track const& track = derivedSeries.GetResampledTrack();
+	std::size_t const size = derivedSeries.Size();
+	auto const& timeMs = track.GetTimeMs();
+
+	// New arrays every time, the chart may still share the old ones
+	auto clockTime = std::make_shared<std::vector<double>>(size);
+	auto elapsedTime = std::make_shared<std::vector<double>>(size);
+	for (std::size_t i = 0; i < size; ++i) {
+		(*clockTime)[i] = static_cast<double>(timeMs[i]);
+		(*elapsedTime)[i] = static_cast<double>(timeMs[i] - timeMs.front()) / 60000.0;
+	}
+	auto distance = std::make_shared<std::vector<double>>(size);
+	computeDistance(track, size, *distance);
+
+	m_axes[static_cast<std::size_t>(AlignmentMode::ClockTime)] = std::move(clockTime);
+	m_axes[static_cast<std::size_t>(AlignmentMode::ElapsedTime)] = std::move(elapsedTime);
+	m_axes[static_cast<std::size_t>(AlignmentMode::Distance)] = std::move(distance);
+	m_gridGeneration = derivedSeries.GetGridGeneration();
+}
+
+std::size_t AlignmentAxes::FindRow(AlignmentMode mode, double x) const {
+	auto const& axis = Get(mode);
+	if (axis == nullptr) return 0;
+	return static_cast<std::size_t>(std::lower_bound(axis->cbegin(), axis->cend(), x) - axis->cbegin());
+}
+
+std::size_t AlignmentAxes::GetMemoryUsage() const {
+	std::size_t result = 0;
+	for (auto const& axis : m_axes) {
+		if (axis != nullptr) result += axis->capacity() * sizeof(double);
+	}
+	return result;
+}
+
+void AlignmentAxes::computeDistance(Track const& track, std::size_t size, std::vector<double>& x) {
+	// Every activity of a file counts its distance from 0 again, so each one continues where the one before ended
+	auto const& activityStarts = track.GetActivityStarts();
+	std::size_t nextActivity = 0;
+	double lastMeters = 0.0;
+	for (std::size_t begin = 0; begin < size;) {
+		while (nextActivity < activityStarts.size() && activityStarts[nextActivity] <= begin) {
+			++nextActivity;
+		}
+		std::size_t const end = (nextActivity < activityStarts.size()) ? std::min<std::size_t>(activityStarts[nextActivity], size) : size;
+		lastMeters = HasDistance(track, begin, end) ? ComputeRecordedDistance(track, begin, end, lastMeters, x) : ComputePositionDistance(track, begin, end, lastMeters, x);
+		begin = end;
+	}
+}
+
+bool ActivityComparison::Add(std::filesystem::path const& file, Track&& track) {
+	if (Contains(file)) return false;
+	auto activity = std::make_unique<Activity>();
+	activity->file = file;
+	activity->track = std::move(track);
+	activity->track.ShrinkToFit();
+	m_activities.push_back(std::move(activity));
+	return true;
+}
+
+bool ActivityComparison::Contains(std::filesystem::path const& file) const {
+	std::error_code error;
+	for (auto const& activity : m_activities) {
+		if (activity->file == file || std::filesystem::equivalent(activity->file, file, error)) return true;
+	}
+	return false;
+}
+
+void ActivityComparison::Remove(std::size_t index) {
+	m_activities.erase(m_activities.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+void ActivityComparison::Clear() {
+	m_activities.clear();
+}
+
+std::size_t ActivityComparison::GetMemoryUsage() const {
+	std::size_t result = 0;
+	for (auto const& activity : m_activities) {
+		result += activity->track.GetMemoryUsage() + activity->derivedSeries.GetMemoryUsage() + activity->axes.GetMemoryUsage();
+	}
+	return result;
+}
+
+std::vector<ActivityComparison::UpdateResult> ActivityComparison::Update(DerivationOptions const& options, std::size_t threadCount) {
+	TRACE_SCOPE("Derive compared series");
+	std::vector<UpdateResult> results(m_activities.size());
+	auto const updateActivity = [&](std::size_t index) {
+		Activity& activity = *m_activities[index];
+		bool const isNew = !activity.derivedSeries.IsValid();
+		try {
+			results[index].recomputed = activity.derivedSeries.Update(activity.track, options);
+			if (isNew) results[index].recomputed.set();
+			// Only a new grid moves the rows, changing filters or the speed source does not
+			if (activity.axes.GetGridGeneration() != activity.derivedSeries.GetGridGeneration()) activity.axes.Compute(activity.derivedSeries);
+		}
+		catch (std::exception const& e) {
+			activity.derivedSeries.Invalidate();
+			results[index].errorMessage = e.what();
+		}
+	};
+
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::min(threadCount, m_activities.size());
+	if (threadCount <= 1) {
+		for (std::size_t i = 0; i < m_activities.size(); ++i) {
+			updateActivity(i);
+		}
+		return results;
+	}
+
+	// Each thread takes the next activity as soon as it is done with its last one, as activities can differ a lot in length
+	std::atomic<std::size_t> nextIndex = 0;
+	{
+		std::vector<std::jthread> threads;
+		threads.reserve(threadCount);
+		for (std::size_t t = 0; t < threadCount; ++t) {
+			threads.emplace_back([&]() {
+				for (std::size_t index = nextIndex++; index < m_activities.size(); index = nextIndex++) {
+					updateActivity(index);
+				}
+			});
+		}
+	}
+	return results;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DerivedSeries.hpp"
+#include "Track.hpp"
+
+// How the activities of a comparison are lined up on the x axis.
+enum class AlignmentMode {
+	// Time of day, so activities only overlap if they happened at the same time
+	ClockTime = 0,
+	// Time since the first sample of each activity
+	ElapsedTime,
+	// Distance covered since the first sample of each activity, along the positions if the activity has no recorded distance
+	Distance
+};
+
+// The x values of every row of a DerivedSeries for each AlignmentMode, in the units the chart shows: milliseconds since the epoch
+// for ClockTime, minutes for ElapsedTime and kilometers for Distance. All of them are computed once per grid, so switching between
+// them only hands out a different array. Every axis is non-decreasing, so it doubles as an index from x to row, e.g. from distance to time.
+class AlignmentAxes {
+public:
+	// Takes O(n). The arrays handed out before stay valid, so the chart can keep drawing them until it switches.
+	void Compute(DerivedSeries const& derivedSeries);
+
+	// Empty until the first call of Compute().
+	inline std::shared_ptr<std::vector<double> const> const& Get(AlignmentMode mode) const {
+		return m_axes[static_cast<std::size_t>(mode)];
+	}
+	// The first row whose x is at or after the given one, Size() of the series if there is none. Takes O(log n).
+	std::size_t FindRow(AlignmentMode mode, double x) const;
+	// The DerivedSeries::GetGridGeneration() of the series the axes were computed for, 0 before the first call of Compute().
+	inline std::uint64_t GetGridGeneration() const {
+		return m_gridGeneration;
+	}
+	std::size_t GetMemoryUsage() const;
+private:
+	std::array<std::shared_ptr<std::vector<double> const>, 3> m_axes;
+	std::uint64_t m_gridGeneration = 0;
+
+	// Rows without a recorded distance repeat the distance of the row before them (0 before the first one),
+	// and the distances of several activities in one file add up. An activity of the file without any recorded distance uses the distance along its positions.
+	static void computeDistance(Track const& track, std::size_t size, std::vector<double>& x);
+};
+
+// Several activities shown together, e.g. the same route over several weeks. Every file is loaded once,
+// and the series of all activities are derived in parallel.
+class ActivityComparison {
+public:
+	struct Activity {
+		std::filesystem::path file;
+		Track track;
+		DerivedSeries derivedSeries;
+		AlignmentAxes axes;
+	};
+
+	struct UpdateResult {
+		// Columns of the activity that were recomputed, all of them for a new activity
+		SeriesColumnSet recomputed;
+		// Why deriving the series failed, empty if it did not
+		std::string errorMessage;
+	};
+
+	// Adds the track, unless the file is part of the comparison already. Returns whether it was added.
+	bool Add(std::filesystem::path const& file, Track&& track);
+	bool Contains(std::filesystem::path const& file) const;
+	void Remove(std::size_t index);
+	void Clear();
+
+	inline std::size_t Size() const {
+		return m_activities.size();
+	}
+	inline bool Empty() const {
+		return m_activities.empty();
+	}
+	// Stays at the same address until the activity is removed.
+	inline Activity const& Get(std::size_t index) const {
+		return *m_activities[index];
+	}
+	std::size_t GetMemoryUsage() const;
+
+	// Brings the derived series of all activities (and their axes) up to date, on up to threadCount threads (0 uses one per hardware thread).
+	// Returns one result per activity. An activity whose series failed is left invalid and tried again with the next call.
+	std::vector<UpdateResult> Update(DerivationOptions const& options, std::size_t threadCount = 0);
+private:
+	// Held by pointer, so the series handed out by Get() stay where they are when activities are added or removed
+	std::vector<std::unique_ptr<Activity>> m_activities;
+};
@@ -0,0 +1,354 @@
+#include "ActivityIndex.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+#include "AtomicFileWrite.hpp"
+#include "DerivedSeries.hpp"
+#include "MappedFileString.hpp"
+#include "ParseError.hpp"
+#include "TrackCache.hpp"
+
+static constexpr char INDEX_MAGIC[8] = { 'T', 'C', 'X', 'I', 'N', 'D', 'E', 'X' };
+// Written as a number, reads differently on a machine with another byte order
+static constexpr std::uint32_t INDEX_BYTE_ORDER_MARK = 0x01020304u;
+
+struct IndexHeader {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byteOrderMark;
+	std::uint64_t entryCount;
+};
+
+// One per entry, followed by the file name (UTF-8, with '/' as separator), the sport and the error message.
+struct IndexRecord {
+	std::uint64_t sourceSize;
+	std::int64_t sourceModificationTimeNs;
+	std::uint64_t trackpoints;
+	std::int64_t startTimeMs;
+	double durationSeconds;
+	double distanceMeters;
+	double movingSpeedMetersPerSecond;
+	double movingPaceMinutesPerKilometer;
+	double avgHeartRateBpm;
+	double maxHeartRateBpm;
+	double minLatitudeDegrees;
+	double maxLatitudeDegrees;
+	double minLongitudeDegrees;
+	double maxLongitudeDegrees;
+	std::uint32_t fileLength;
+	std::uint32_t sportLength;
+	std::uint32_t errorMessageLength;
+	std::uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable_v<IndexHeader> && std::is_trivially_copyable_v<IndexRecord>);
+
+static std::string ToIndexString(std::filesystem::path const& file) {
+	auto const u8 = file.generic_u8string();
+	return std::string(u8.begin(), u8.end());
+}
+
+static std::filesystem::path FromIndexString(std::string_view file) {
+	return std::filesystem::path(std::u8string(file.begin(), file.end()));
+}
+
+static bool IsTcxFile(std::filesystem::path const& path) {
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return extension == ".tcx";
+}
+
+// Names of the distinct sports of all activities, e.g. "Running" or "Biking, Running"
+static std::string GetSportsDescription(Track const& track) {
+	std::vector<Sport> sports = track.GetActivitySports();
+	std::sort(sports.begin(), sports.end());
+	sports.erase(std::unique(sports.begin(), sports.end()), sports.end());
+	std::string result;
+	for (Sport const sport : sports) {
+		if (!result.empty()) result += ", ";
+		result += GetSportName(sport);
+	}
+	return result;
+}
+
+ActivityIndex::ActivityIndex(std::filesystem::path directory) : m_directory(std::move(directory)), m_entries() {
+	//
+}
+
+std::filesystem::path ActivityIndex::GetIndexPath(std::filesystem::path const& directory) {
+	return directory / ".tcxindex";
+}
+
+std::vector<std::filesystem::path> ActivityIndex::FindTcxFiles(std::filesystem::path const& directory, std::error_code& error) {
+	std::vector<std::filesystem::path> result;
+	error.clear();
+	std::filesystem::recursive_directory_iterator it(directory, std::filesystem::directory_options::skip_permission_denied, error);
+	for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+		// An entry that vanished in the meantime is just not a file
+		std::error_code entryError;
+		if (it->is_regular_file(entryError) && IsTcxFile(it->path())) {
+			result.push_back(it->path());
+		}
+	}
+	// Directory iteration order is unspecified, but the output should not be
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+ActivityIndex ActivityIndex::Read(std::filesystem::path const& directory) {
+	ActivityIndex result(directory);
+	auto const indexFile = GetIndexPath(directory);
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(indexFile, error)) {
+		return result;
+	}
+
+	std::optional<MappedFileString> mappedIndex;
+	try {
+		mappedIndex.emplace(indexFile.string());
+	}
+	catch (std::system_error const&) {
+		return result;
+	}
+	std::string_view const content = mappedIndex.value().GetView();
+
+	std::size_t position = 0;
+	auto const read = [&](void* target, std::size_t size) {
+		if (size > (content.size() - position)) return false;
+		std::memcpy(target, content.data() + position, size);
+		position += size;
+		return true;
+	};
+	auto const readString = [&](std::size_t size, std::string_view& target) {
+		if (size > (content.size() - position)) return false;
+		target = content.substr(position, size);
+		position += size;
+		return true;
+	};
+
+	IndexHeader header;
+	if (!read(&header, sizeof(header))) return result;
+	if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header.version != VERSION || header.byteOrderMark != INDEX_BYTE_ORDER_MARK) {
+		return result;
+	}
+	// Keeps a damaged count from causing huge allocations
+	if (header.entryCount > (content.size() / sizeof(IndexRecord))) {
+		return result;
+	}
+
+	std::vector<ActivityIndexEntry> entries;
+	entries.reserve(static_cast<std::size_t>(header.entryCount));
+	for (std::uint64_t i = 0; i < header.entryCount; ++i) {
+		IndexRecord record;
+		std::string_view file;
+		std::string_view sport;
+		std::string_view errorMessage;
+		if (!read(&record, sizeof(record)) || !readString(record.fileLength, file) || !readString(record.sportLength, sport) || !readString(record.errorMessageLength, errorMessage)) {
+			return result;
+		}
+
+		ActivityIndexEntry entry;
+		entry.file = FromIndexString(file);
+		entry.sourceSize = record.sourceSize;
+		entry.sourceModificationTimeNs = record.sourceModificationTimeNs;
+		entry.sport = sport;
+		entry.summary.trackpoints = static_cast<std::size_t>(record.trackpoints);
+		entry.summary.startTimeMs = record.startTimeMs;
+		entry.summary.durationSeconds = record.durationSeconds;
+		entry.summary.distanceMeters = record.distanceMeters;
+		entry.summary.movingSpeedMetersPerSecond = record.movingSpeedMetersPerSecond;
+		entry.summary.movingPaceMinutesPerKilometer = record.movingPaceMinutesPerKilometer;
+		entry.summary.avgHeartRateBpm = record.avgHeartRateBpm;
+		entry.summary.maxHeartRateBpm = record.maxHeartRateBpm;
+		entry.summary.minLatitudeDegrees = record.minLatitudeDegrees;
+		entry.summary.maxLatitudeDegrees = record.maxLatitudeDegrees;
+		entry.summary.minLongitudeDegrees = record.minLongitudeDegrees;
+		entry.summary.maxLongitudeDegrees = record.maxLongitudeDegrees;
+		entry.errorMessage = errorMessage;
+		entries.push_back(std::move(entry));
+	}
+	if (position != content.size()) {
+		return result;
+	}
+
+	result.m_entries = std::move(entries);
+	return result;
+}
+
+void ActivityIndex::Write() const {
+	IndexHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	header.version = VERSION;
+	header.byteOrderMark = INDEX_BYTE_ORDER_MARK;
+	header.entryCount = m_entries.size();
+
+	WriteFileAtomically(GetIndexPath(m_directory), [&](std::ostream& out) {
+		auto const write = [&](void const* data, std::size_t size) {
+			out.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+		};
+
+		write(&header, sizeof(header));
+		for (auto const& entry : m_entries) {
+			std::string const file = ToIndexString(entry.file);
+
+			IndexRecord record;
+			std::memset(&record, 0, sizeof(record));
+			record.sourceSize = entry.sourceSize;
+			record.sourceModificationTimeNs = entry.sourceModificationTimeNs;
+			record.trackpoints = entry.summary.trackpoints;
+			record.startTimeMs = entry.summary.startTimeMs;
+			record.durationSeconds = entry.summary.durationSeconds;
+			record.distanceMeters = entry.summary.distanceMeters;
+			record.movingSpeedMetersPerSecond = entry.summary.movingSpeedMetersPerSecond;
+			record.movingPaceMinutesPerKilometer = entry.summary.movingPaceMinutesPerKilometer;
+			record.avgHeartRateBpm = entry.summary.avgHeartRateBpm;
+			record.maxHeartRateBpm = entry.summary.maxHeartRateBpm;
+			record.minLatitudeDegrees = entry.summary.minLatitudeDegrees;
+			record.maxLatitudeDegrees = entry.summary.maxLatitudeDegrees;
+			record.minLongitudeDegrees = entry.summary.minLongitudeDegrees;
+			record.maxLongitudeDegrees = entry.summary.maxLongitudeDegrees;
+			record.fileLength = static_cast<std::uint32_t>(file.size());
+			record.sportLength = static_cast<std::uint32_t>(entry.sport.size());
+			record.errorMessageLength = static_cast<std::uint32_t>(entry.errorMessage.size());
+
+			write(&record, sizeof(record));
+			write(file.data(), file.size());
+			write(entry.sport.data(), entry.sport.size());
+			write(entry.errorMessage.data(), entry.errorMessage.size());
+		}
+	});
+}
+
+ActivityIndex::UpdateStatistics ActivityIndex::Update(BatchLoader const& loader, bool doDebugOutput, ParserBackend backend, UpdateProgressCallback const& progressCallback) {
+	UpdateStatistics statistics;
+
+	std::unordered_map<std::string, std::size_t> entryByFile;
+	for (std::size_t i = 0; i < m_entries.size(); ++i) {
+		entryByFile.emplace(ToIndexString(m_entries[i].file), i);
+	}
+
+	// Unchanged entries are taken over as they are, everything else is parsed
+	std::vector<ActivityIndexEntry> entries;
+	std::vector<std::filesystem::path> filesToParse;
+	std::vector<TrackCache::SourceInfo> sourceInfos;
+	std::vector<std::optional<std::size_t>> previousEntries;
+	std::size_t foundEntries = 0;
+	std::error_code error;
+	if (std::filesystem::is_directory(m_directory, error)) {
+		auto const files = FindTcxFiles(m_directory, error);
+		// Files that were not found would be dropped from the index as removed
+		if (error) {
+			throw std::runtime_error("Failed to search '" + m_directory.string() + "' for TCX files: " + error.message());
+		}
+		for (auto const& file : files) {
+			// Taken before parsing, so a file changed in the meantime is parsed again with the next update
+			auto const sourceInfo = TrackCache::GetSourceInfo(file);
+			if (!sourceInfo.has_value()) continue;
+
+			std::optional<std::size_t> previousEntry;
+			auto const it = entryByFile.find(ToIndexString(file.lexically_relative(m_directory)));
+			if (it != entryByFile.end()) {
+				previousEntry = it->second;
+				++foundEntries;
+				ActivityIndexEntry const& entry = m_entries[it->second];
+				if (entry.sourceSize == sourceInfo.value().size && entry.sourceModificationTimeNs == sourceInfo.value().modificationTimeNs) {
+					entries.push_back(entry);
+					++statistics.unchanged;
+					continue;
+				}
+			}
+			filesToParse.push_back(file);
+			sourceInfos.push_back(sourceInfo.value());
+			previousEntries.push_back(previousEntry);
+		}
+	}
+	statistics.removed = m_entries.size() - foundEntries;
+	if (doDebugOutput) std::cerr << "Updating index of '" << m_directory.string() << "': " << filesToParse.size() << " files to parse, " << statistics.unchanged << " unchanged." << std::endl;
+
+	std::vector<bool> isParsed(filesToParse.size(), false);
+	DerivedSeries derivedSeries;
+	std::size_t filesDone = 0;
+	// The loader asks the workers as well, which may not call progressCallback, so they only see what it returned last
+	std::atomic<bool> isCancelled = false;
+	std::thread::id const updateThread = std::this_thread::get_id();
+	auto const shouldStop = [&]() {
+		if (progressCallback && std::this_thread::get_id() == updateThread && !progressCallback(filesDone, filesToParse.size())) {
+			isCancelled = true;
+		}
+		return isCancelled.load();
+	};
+	try {
+		loader.Load(filesToParse, doDebugOutput, backend, [&](BatchResult&& result) {
+			ActivityIndexEntry entry;
+			entry.file = result.file.lexically_relative(m_directory);
+			entry.sourceSize = sourceInfos[result.index].size;
+			entry.sourceModificationTimeNs = sourceInfos[result.index].modificationTimeNs;
+			if (result.track.has_value()) {
+				Track const& track = result.track.value();
+				entry.sport = GetSportsDescription(track);
+				try {
+					derivedSeries.Compute(track, DerivationOptions());
+					entry.summary = ComputeActivitySummary(track, derivedSeries);
+				}
+				catch (std::exception const& e) {
+					// Everything but the speed is still worth listing
+					if (doDebugOutput) std::cerr << "Warning: Failed to derive the series of '" << result.file.string() << "': " << e.what() << std::endl;
+					entry.summary = ComputeActivitySummary(track, DerivedSeries());
+				}
+			}
+			else {
+				entry.errorMessage = result.errorMessage.empty() ? std::string("Unknown error") : result.errorMessage;
+				++statistics.failed;
+			}
+
+			if (previousEntries[result.index].has_value()) {
+				++statistics.changed;
+			}
+			else {
+				++statistics.added;
+			}
+			entries.push_back(std::move(entry));
+			isParsed[result.index] = true;
+
+			++filesDone;
+			if (progressCallback && !progressCallback(filesDone, filesToParse.size())) {
+				isCancelled = true;
+				throw ParseCancelled();
+			}
+		}, shouldStop);
+	}
+	catch (ParseCancelled const&) {
+		statistics.wasCancelled = true;
+		// Outdated entries of the files not parsed are kept, they still have the old size and modification time, so the next update parses them
+		for (std::size_t i = 0; i < filesToParse.size(); ++i) {
+			if (!isParsed[i] && previousEntries[i].has_value()) {
+				entries.push_back(m_entries[previousEntries[i].value()]);
+			}
+		}
+	}
+
+	m_entries = std::move(entries);
+	SortEntries();
+	return statistics;
+}
+
+void ActivityIndex::SortEntries() {
+	std::sort(m_entries.begin(), m_entries.end(), [](ActivityIndexEntry const& a, ActivityIndexEntry const& b) {
+		if (a.IsValid() != b.IsValid()) return a.IsValid();
+		if (a.summary.startTimeMs != b.summary.startTimeMs) return a.summary.startTimeMs < b.summary.startTimeMs;
+		return a.file < b.file;
+	});
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "ActivitySummary.hpp"
+#include "BatchLoader.hpp"
+#include "Parser.hpp"
+
+struct ActivityIndexEntry {
+	// Relative to the directory of the index
+	std::filesystem::path file;
+	// Size and modification time of the file when it was indexed, see TrackCache::SourceInfo
+	std::uint64_t sourceSize = 0;
+	std::int64_t sourceModificationTimeNs = 0;
+	std::string sport;
+	ActivitySummary summary;
+	// Set if the file could not be parsed. Such files stay in the index, so they are not parsed again on every update.
+	std::string errorMessage;
+
+	inline bool IsValid() const {
+		return errorMessage.empty();
+	}
+};
+
+// Metadata of all TCX files in a directory (searched recursively), kept in a single index file in that directory.
+// Reading the index does not touch any of the TCX files, so even large libraries can be listed instantly.
+// Update() only parses the files that were added or changed since the index was written.
+class ActivityIndex {
+public:
+	// Has to be increased whenever the stored entries change, in layout or meaning.
+	static constexpr std::uint32_t VERSION = 3;
+
+	// Called on the thread of Update() after every parsed file and at least every BatchLoader::STOP_POLL_INTERVAL while waiting for one.
+	// Returning false cancels the update, including the files being parsed.
+	using UpdateProgressCallback = std::function<bool(std::size_t filesDone, std::size_t filesTotal)>;
+
+	struct UpdateStatistics {
+		std::size_t added = 0;
+		std::size_t changed = 0;
+		std::size_t removed = 0;
+		std::size_t unchanged = 0;
+		std::size_t failed = 0;
+		bool wasCancelled = false;
+	};
+
+	// An empty index of directory, nothing is read.
+	explicit ActivityIndex(std::filesystem::path directory);
+
+	// The index of a directory is the file ".tcxindex" in it.
+	static std::filesystem::path GetIndexPath(std::filesystem::path const& directory);
+	// All TCX files in directory and its subdirectories, sorted by path. Stops at the first directory that can not be read (other than for
+	// missing permissions, those are skipped) and sets error, the files found until then are still returned.
+	static std::vector<std::filesystem::path> FindTcxFiles(std::filesystem::path const& directory, std::error_code& error);
+
+	// Reads the index of directory. Returns an empty index if there is none, or if it is of another version or damaged.
+	static ActivityIndex Read(std::filesystem::path const& directory);
+	// Replaces the index file, readers never see a partially written one. Throws std::runtime_error if it can not be written.
+	void Write() const;
+
+	// Brings the entries up to date with the files in the directory. If cancelled, the entries parsed so far are kept.
+	UpdateStatistics Update(BatchLoader const& loader, bool doDebugOutput, ParserBackend backend, UpdateProgressCallback const& progressCallback = UpdateProgressCallback());
+
+	inline std::filesystem::path const& GetDirectory() const {
+		return m_directory;
+	}
+	// Sorted by start time, files that could not be parsed come last.
+	inline std::vector<ActivityIndexEntry> const& GetEntries() const {
+		return m_entries;
+	}
+private:
+	std::filesystem::path m_directory;
+	std::vector<ActivityIndexEntry> m_entries;
+
+	void SortEntries();
+};
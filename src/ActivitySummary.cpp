@@ -0,0 +1,91 @@
+#include "ActivitySummary.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SeriesKernels.hpp"
+
+ActivitySummary::ActivitySummary() :
+	trackpoints(0),
+	startTimeMs(0),
+	durationSeconds(MISSING_VALUE),
+	distanceMeters(MISSING_VALUE),
+	movingSpeedMetersPerSecond(MISSING_VALUE),
+	movingPaceMinutesPerKilometer(MISSING_VALUE),
+	avgHeartRateBpm(MISSING_VALUE),
+	maxHeartRateBpm(MISSING_VALUE),
+	minLatitudeDegrees(MISSING_VALUE),
+	maxLatitudeDegrees(MISSING_VALUE),
+	minLongitudeDegrees(MISSING_VALUE),
+	maxLongitudeDegrees(MISSING_VALUE)
+{}
+
+ActivitySummary ComputeActivitySummary(Track const& track, DerivedSeries const& derivedSeries) {
+	ActivitySummary result;
+	result.trackpoints = track.Size();
+	if (track.Empty()) {
+		return result;
+	}
+
+	auto const& timeMs = track.GetTimeMs();
+	result.startTimeMs = timeMs.front();
+	result.durationSeconds = static_cast<double>(timeMs.back() - timeMs.front()) / 1000.0;
+
+	// Distances start over with every activity of the file
+	auto const& distanceMeters = track.GetDistanceMeters();
+	auto const& hasDistance = track.GetDistanceValidity();
+	auto const& activityStarts = track.GetActivityStarts();
+	for (std::size_t a = 0; a < activityStarts.size(); ++a) {
+		std::size_t const activityEnd = ((a + 1) < activityStarts.size()) ? static_cast<std::size_t>(activityStarts[a + 1]) : track.Size();
+		std::size_t firstDistance = static_cast<std::size_t>(activityStarts[a]);
+		while (firstDistance < activityEnd && !hasDistance.Test(firstDistance)) ++firstDistance;
+		for (std::size_t i = activityEnd; i > firstDistance; --i) {
+			if (hasDistance.Test(i - 1)) {
+				result.distanceMeters = (std::isnan(result.distanceMeters) ? 0.0 : result.distanceMeters) + (distanceMeters[i - 1] - distanceMeters[firstDistance]);
+				break;
+			}
+		}
+	}
+
+	double speedSum = 0.0;
+	std::size_t speedCount = 0;
+	for (double const speed : derivedSeries.GetColumn(SeriesColumn::Speed)) {
+		if (std::isnan(speed)) continue;
+		speedSum += speed;
+		++speedCount;
+	}
+	if (speedCount > 0) {
+		result.movingSpeedMetersPerSecond = speedSum / static_cast<double>(speedCount);
+		result.movingPaceMinutesPerKilometer = 1.0 / (METERS_PER_SECOND_TO_KILOMETERS_PER_HOUR(result.movingSpeedMetersPerSecond) / 60.0);
+	}
+
+	auto const& heartRateBpm = track.GetHeartRateBpm();
+	auto const& hasHeartRate = track.GetHeartRateValidity();
+	double heartRateSum = 0.0;
+	std::size_t heartRateCount = 0;
+	std::uint8_t maxHeartRate = 0;
+	for (std::size_t i = 0; i < track.Size(); ++i) {
+		if (!hasHeartRate.Test(i)) continue;
+		heartRateSum += heartRateBpm[i];
+		maxHeartRate = std::max(maxHeartRate, heartRateBpm[i]);
+		++heartRateCount;
+	}
+	if (heartRateCount > 0) {
+		result.avgHeartRateBpm = heartRateSum / static_cast<double>(heartRateCount);
+		result.maxHeartRateBpm = maxHeartRate;
+	}
+
+	auto const& latitudeDegrees = track.GetLatitudeDegrees();
+	auto const& longitudeDegrees = track.GetLongitudeDegrees();
+	auto const& hasPosition = track.GetPositionValidity();
+	for (std::size_t i = 0; i < track.Size(); ++i) {
+		if (!hasPosition.Test(i)) continue;
+		// NaN compares false, so the first position initializes the box
+		if (!(latitudeDegrees[i] >= result.minLatitudeDegrees)) result.minLatitudeDegrees = latitudeDegrees[i];
+		if (!(latitudeDegrees[i] <= result.maxLatitudeDegrees)) result.maxLatitudeDegrees = latitudeDegrees[i];
+		if (!(longitudeDegrees[i] >= result.minLongitudeDegrees)) result.minLongitudeDegrees = longitudeDegrees[i];
+		if (!(longitudeDegrees[i] <= result.maxLongitudeDegrees)) result.maxLongitudeDegrees = longitudeDegrees[i];
+	}
+
+	return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DerivedSeries.hpp"
+#include "Track.hpp"
+
+// Key figures of one activity, e.g. for listing many of them. Values that can not be determined are NaN.
+struct ActivitySummary {
+	std::size_t trackpoints;
+	std::int64_t startTimeMs;
+	double durationSeconds;
+	double distanceMeters;
+	// Average over the samples the runner was moving, see ComputeSpeed()
+	double movingSpeedMetersPerSecond;
+	double movingPaceMinutesPerKilometer;
+	double avgHeartRateBpm;
+	double maxHeartRateBpm;
+	// Bounding box of all positions
+	double minLatitudeDegrees;
+	double maxLatitudeDegrees;
+	double minLongitudeDegrees;
+	double maxLongitudeDegrees;
+
+	ActivitySummary();
+};
+
+ActivitySummary ComputeActivitySummary(Track const& track, DerivedSeries const& derivedSeries);
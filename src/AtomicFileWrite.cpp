@@ -0,0 +1,38 @@
+#include "AtomicFileWrite.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+void WriteFileAtomically(std::filesystem::path const& file, std::function<void(std::ostream& out)> const& write) {
+	std::filesystem::path temporaryFile = file;
+	temporaryFile += ".tmp";
+	// Separate from the error being reported, failing to clean up is not worth mentioning over it
+	std::error_code removeError;
+	{
+		std::ofstream out(temporaryFile, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			throw std::runtime_error("Failed to open '" + temporaryFile.string() + "' for writing!");
+		}
+		try {
+			write(out);
+		}
+		catch (...) {
+			out.close();
+			std::filesystem::remove(temporaryFile, removeError);
+			throw;
+		}
+		out.close();
+		if (!out) {
+			std::filesystem::remove(temporaryFile, removeError);
+			throw std::runtime_error("Failed to write '" + temporaryFile.string() + "'!");
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryFile, file, error);
+	if (error) {
+		std::filesystem::remove(temporaryFile, removeError);
+		throw std::runtime_error("Failed to replace '" + file.string() + "': " + error.message());
+	}
+}
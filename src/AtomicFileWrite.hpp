@@ -0,0 +1,10 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <ostream>
+
+// Writes file by handing a stream on a temporary file next to it to write, then renames that over file. So readers either see the old or
+// the new file, never a partial one. Throws std::runtime_error if the file can not be written or replaced (or rethrows what write threw),
+// the temporary file is removed then.
+void WriteFileAtomically(std::filesystem::path const& file, std::function<void(std::ostream& out)> const& write);
@@ -0,0 +1,149 @@
+#include "BatchLoader.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "TrackCache.hpp"
+
+BatchLoader::BatchLoader(std::size_t threadCount, std::size_t maxInFlight, bool useTrackCache) : m_threadCount(threadCount), m_maxInFlight(maxInFlight), m_useTrackCache(useTrackCache) {
+	if (m_threadCount == 0) {
+		m_threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if (m_maxInFlight == 0) {
+		m_maxInFlight = 2 * m_threadCount;
+	}
+}
+
+static BatchResult LoadFile(std::size_t index, std::filesystem::path const& file, bool doDebugOutput, ParserBackend backend, unsigned int threadsPerFile, bool useTrackCache, ParseProgressCallback const& progressCallback) {
+	BatchResult result;
+	result.index = index;
+	result.file = file;
+	try {
+		if (useTrackCache) {
+			result.track = TrackCache::Read(file);
+			result.wasCached = result.track.has_value();
+		}
+		if (!result.track.has_value()) {
+			auto const sourceInfo = useTrackCache ? TrackCache::GetSourceInfo(file) : std::nullopt;
+			Parser parser(file, doDebugOutput, backend, threadsPerFile, progressCallback);
+			result.track = parser.TakeTrack();
+			// Written here instead of by TrackCache::Load(), so failing to write is reported instead of ignored
+			if (useTrackCache) {
+				try {
+					if (!sourceInfo.has_value()) {
+						throw std::runtime_error("Failed to get size and modification time of '" + file.string() + "'!");
+					}
+					TrackCache::Write(file, sourceInfo.value(), result.track.value());
+				}
+				catch (std::exception const& e) {
+					result.cacheErrorMessage = e.what();
+				}
+			}
+		}
+	}
+	catch (std::exception const& e) {
+		result.track = std::nullopt;
+		result.errorMessage = e.what();
+	}
+	return result;
+}
+
+void BatchLoader::Load(std::vector<std::filesystem::path> const& files, bool doDebugOutput, ParserBackend backend, std::function<void(BatchResult&&)> const& consumer, StopPredicate const& shouldStop) const {
+	std::size_t const fileCount = files.size();
+	if (fileCount == 0) {
+		return;
+	}
+
+	// Only with fewer files than threads, large ones may additionally be split up by the parser itself
+	unsigned int const threadsPerFile = static_cast<unsigned int>(std::max<std::size_t>(1, m_threadCount / fileCount));
+
+	// File i goes into slot i % slotCount. A file may only be claimed once the file slotCount positions before it has been consumed, so its slot is free.
+	std::size_t const slotCount = std::min(m_maxInFlight, fileCount);
+	std::vector<std::optional<BatchResult>> slots(slotCount);
+	std::mutex mutex;
+	std::condition_variable slotFilled;
+	std::condition_variable slotFreed;
+	std::size_t nextToClaim = 0;
+	std::size_t nextToConsume = 0;
+	bool stop = false;
+
+	auto const isStopRequested = [&]() {
+		return shouldStop && shouldStop();
+	};
+	// A parse cancelled this way throws ParseCancelled, which only ends up in the result of its file, the consumer never sees it
+	ParseProgressCallback const progressCallback = shouldStop ? ParseProgressCallback([&](std::size_t, std::size_t) { return !shouldStop(); }) : ParseProgressCallback();
+
+	auto const worker = [&]() {
+		while (!isStopRequested()) {
+			std::size_t index = 0;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				slotFreed.wait(lock, [&]() { return stop || nextToClaim >= fileCount || nextToClaim < nextToConsume + slotCount; });
+				if (stop || nextToClaim >= fileCount) {
+					return;
+				}
+				index = nextToClaim++;
+			}
+
+			BatchResult result = LoadFile(index, files[index], doDebugOutput, backend, threadsPerFile, m_useTrackCache, progressCallback);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slots[index % slotCount].emplace(std::move(result));
+			}
+			slotFilled.notify_one();
+		}
+	};
+
+	// Declared after everything the workers use, so they are joined before any of it goes away
+	std::size_t const threadCount = std::min(m_threadCount, fileCount);
+	std::vector<std::jthread> threads;
+	threads.reserve(threadCount);
+	for (std::size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(worker);
+	}
+
+	try {
+		// nextToConsume is only ever changed here, so reading it outside of the lock is fine
+		while (nextToConsume < fileCount) {
+			std::optional<BatchResult> result;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				auto& slot = slots[nextToConsume % slotCount];
+				if (shouldStop) {
+					// The workers may have stopped without filling the slot, so nothing would wake us up. Asked without the lock, as it may take a while.
+					while (!slotFilled.wait_for(lock, STOP_POLL_INTERVAL, [&]() { return slot.has_value(); })) {
+						lock.unlock();
+						bool const isStopped = shouldStop();
+						lock.lock();
+						if (isStopped) {
+							throw ParseCancelled();
+						}
+					}
+				}
+				else {
+					slotFilled.wait(lock, [&]() { return slot.has_value(); });
+				}
+				result.swap(slot);
+				++nextToConsume;
+			}
+			slotFreed.notify_all();
+			// The result may be that of a cancelled parse
+			if (isStopRequested()) {
+				throw ParseCancelled();
+			}
+			consumer(std::move(result.value()));
+		}
+	}
+	catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		slotFreed.notify_all();
+		throw;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Parser.hpp"
+#include "Track.hpp"
+
+struct BatchResult {
+	// Position of the file in the list given to BatchLoader::Load()
+	std::size_t index;
+	std::filesystem::path file;
+	// Empty if the file could not be parsed, errorMessage says why in that case.
+	std::optional<Track> track;
+	std::string errorMessage;
+	// Whether the track came from an up to date TrackCache instead of the parser
+	bool wasCached = false;
+	// Why the cache of a parsed file could not be written, empty if it was (or if caches are not used). The track is fine either way.
+	std::string cacheErrorMessage;
+};
+
+// Parses many files concurrently on a set of worker threads, each of which takes the next unclaimed file as soon as it is done with its last one.
+// Results are handed to the consumer strictly in the order of the input files, no matter which file finished first, so the output is deterministic.
+// At most maxInFlight files are being parsed or waiting for the consumer at any time, which bounds the memory when the consumer is slower than the workers.
+class BatchLoader {
+public:
+	// Asked by the workers while they parse (see ParseProgressCallback) and by the calling thread while it waits, so it has to be thread safe.
+	// Returning true stops the whole batch.
+	using StopPredicate = std::function<bool()>;
+
+	// How often the calling thread asks the StopPredicate while it waits for the next file.
+	static constexpr std::chrono::milliseconds STOP_POLL_INTERVAL = std::chrono::milliseconds(50);
+
+	// A threadCount of 0 uses one thread per hardware thread, a maxInFlight of 0 uses twice the number of threads.
+	// With useTrackCache, tracks are read from their TrackCache if it is up to date, and caches are written for the files that had to be parsed.
+	BatchLoader(std::size_t threadCount = 0, std::size_t maxInFlight = 0, bool useTrackCache = false);
+
+	// Blocks until all files have been parsed and consumed. The consumer is called on the calling thread, once per file, including failed ones.
+	// If the consumer throws, the files not yet started are skipped and the exception is rethrown once all workers stopped.
+	// If shouldStop returns true, the files being parsed are cancelled as well, no further results are consumed and ParseCancelled is thrown once all workers stopped.
+	void Load(std::vector<std::filesystem::path> const& files, bool doDebugOutput, ParserBackend backend, std::function<void(BatchResult&&)> const& consumer, StopPredicate const& shouldStop = StopPredicate()) const;
+
+	inline std::size_t GetThreadCount() const {
+		return m_threadCount;
+	}
+private:
+	std::size_t m_threadCount;
+	std::size_t m_maxInFlight;
+	bool m_useTrackCache;
+};
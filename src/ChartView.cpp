@@ -1,18 +1,34 @@
 #include "ChartView.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <span>
 
+#include <QFontMetricsF>
+#include <QMessageBox>
 #include <QMouseEvent>
 #include <QLineSeries>
-#include <QValueAxis>
+#include <QStringList>
+
+#include "Decimation.hpp"
+#include "Trace.hpp"
 
 static bool constexpr DO_DEBUG = false;
+// Used while the chart has not been laid out yet and the plot area has no width
+static std::size_t constexpr DEFAULT_DECIMATION_THRESHOLD = 4000;
 
 ChartView::ChartView(QChart* chart, QWidget* parent)
 	: QChartView(chart, parent)
 	, m_chart(chart)
 {
 	setRubberBand(QChartView::RectangleRubberBand);
+
+	if (!QObject::connect(chart, SIGNAL(plotAreaChanged(QRectF)), this, SLOT(redecimate()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to connect signal plotAreaChanged in ChartView!");
+		throw;
+	}
 }
 
 ChartView::~ChartView() {
@@ -22,6 +38,77 @@ ChartView::~ChartView() {
 	}
 }
 
+void ChartView::setSeriesData(QXYSeries* series, std::shared_ptr<std::vector<double> const> x, std::span<double const> y) {
+	auto& data = m_seriesData[series];
+	data.x = std::move(x);
+	data.y = y.first(std::min(y.size(), data.x->size()));
+	decimateSeries(series, data);
+}
+
+void ChartView::setSeriesX(QXYSeries* series, std::shared_ptr<std::vector<double> const> x) {
+	auto const data = m_seriesData.find(series);
+	if (data == m_seriesData.end()) return;
+	data->second.x = std::move(x);
+	data->second.y = data->second.y.first(std::min(data->second.y.size(), data->second.x->size()));
+}
+
+void ChartView::removeSeriesData(QXYSeries* series) {
+	m_seriesData.erase(series);
+}
+
+void ChartView::setTimingOverlayVisible(bool isVisible) {
+	m_showTimingOverlay = isVisible;
+	scene()->update();
+}
+
+void ChartView::redecimate() {
+	for (auto const& [series, data] : m_seriesData) {
+		decimateSeries(static_cast<QXYSeries*>(series), data);
+	}
+}
+
+void ChartView::decimateSeries(QXYSeries* series, SeriesData const& data) {
+	TRACE_SCOPE("Decimate series");
+	std::vector<double> const& dataX = *data.x;
+	std::size_t begin = 0;
+	std::size_t end = data.y.size();
+	std::size_t threshold = DEFAULT_DECIMATION_THRESHOLD;
+
+	QRectF const plotArea = chart()->plotArea();
+	if (plotArea.width() >= 1.0) {
+		qreal const minX = chart()->mapToValue(plotArea.bottomLeft(), series).x();
+		qreal const maxX = chart()->mapToValue(plotArea.topRight(), series).x();
+		// Keep one point beyond each border, so the lines continue to the edges of the plot
+		auto const xEnd = dataX.cbegin() + static_cast<std::ptrdiff_t>(data.y.size());
+		begin = static_cast<std::size_t>(std::lower_bound(dataX.cbegin(), xEnd, minX) - dataX.cbegin());
+		end = static_cast<std::size_t>(std::upper_bound(dataX.cbegin(), xEnd, maxX) - dataX.cbegin());
+		begin = (begin > 0) ? (begin - 1) : 0;
+		end = std::min(end + 1, data.y.size());
+		threshold = std::max<std::size_t>(static_cast<std::size_t>(2.0 * plotArea.width()), 3);
+	}
+	if (begin >= end) {
+		series->clear();
+		return;
+	}
+
+	// Only the visible part without the missing values is gathered, the full data stays where it is
+	m_visibleX.clear();
+	m_visibleY.clear();
+	for (std::size_t i = begin; i < end; ++i) {
+		if (std::isnan(data.y[i])) continue;
+		m_visibleX.push_back(dataX[i]);
+		m_visibleY.push_back(data.y[i]);
+	}
+	DecimateLttb(m_visibleX, m_visibleY, threshold, m_selectedIndices);
+
+	QList<QPointF> points;
+	points.reserve(static_cast<qsizetype>(m_selectedIndices.size()));
+	for (auto const index : m_selectedIndices) {
+		points.append(QPointF(m_visibleX[index], m_visibleY[index]));
+	}
+	series->replace(points);
+}
+
 bool ChartView::viewportEvent(QEvent* event)
 {
 	if (event->type() == QEvent::TouchBegin) {
@@ -52,13 +139,8 @@ void ChartView::mouseMoveEvent(QMouseEvent* event)
 
 	QPointF const scene_position = mapToScene(event->pos());
 	QPointF const chart_position = chart()->mapFromScene(scene_position);
-	auto value_at_position = chart()->mapToValue(chart_position);
-	auto const axes = chart()->axes(Qt::Horizontal);
-	if (axes.size() < 1) {
-		throw;
-	}
-	QValueAxis* xAxis = static_cast<QValueAxis*>(axes.at(0));
-	if (xAxis->min() < value_at_position.x() && value_at_position.x() < xAxis->max()) {
+	// The x axis is a QDateTimeAxis or a QValueAxis depending on the alignment, the plot area covers both
+	if (chart()->plotArea().contains(chart_position)) {
 		m_cursorPos = scene_position;
 		// update();
 		scene()->update();
@@ -113,7 +195,42 @@ void ChartView::keyPressEvent(QKeyEvent* event)
 	}
 }
 
+void ChartView::paintEvent(QPaintEvent* event) {
+	TRACE_SCOPE("Frame");
+	QChartView::paintEvent(event);
+}
+
+void ChartView::drawTimingOverlay(QPainter* painter) {
+	QStringList lines;
+	for (auto const& [name, durationMs] : Trace::GetLatestDurationsMs()) {
+		lines.append(QString("%1: %2 ms").arg(QString::fromUtf8(name)).arg(durationMs, 0, 'f', 2));
+	}
+	if (lines.isEmpty()) {
+		lines.append("No timings recorded yet.");
+	}
+
+	painter->save();
+	QFont font = painter->font();
+	font.setPointSizeF(9.0);
+	painter->setFont(font);
+	QFontMetricsF const metrics(font);
+	qreal width = 0.0;
+	for (auto const& line : lines) {
+		width = std::max(width, metrics.horizontalAdvance(line));
+	}
+	// Pinned to the top left corner of the view, no matter how the scene is scrolled
+	QRectF const box(mapToScene(QPoint(8, 8)), QSizeF(width + 12.0, metrics.lineSpacing() * lines.size() + 8.0));
+	painter->fillRect(box, QBrush(QColor(255, 255, 255, 220)));
+	painter->setPen(QPen(QColor("black")));
+	painter->drawText(box.adjusted(6.0, 4.0, -6.0, -4.0), Qt::AlignLeft | Qt::AlignTop, lines.join('\n'));
+	painter->restore();
+}
+
 void ChartView::drawForeground(QPainter* painter, QRectF const&) {
+	TRACE_SCOPE("Draw foreground");
+	if (m_showTimingOverlay) {
+		drawTimingOverlay(painter);
+	}
 	if (!m_cursorPos.has_value())
 		return;
 	painter->save();
@@ -138,9 +255,15 @@ void ChartView::drawForeground(QPainter* painter, QRectF const&) {
 		m_values.resize(series.size() * 2);
 	}
 
+	// Series without a point under the cursor report NaN instead of keeping the values of an earlier position
+	std::fill(m_values.begin(), m_values.end(), std::numeric_limits<qreal>::quiet_NaN());
+
 	QPointF const chart_position = chart()->mapFromScene(p);
-	std::size_t index = 0;
+	// All series share the x axis, so any of them maps the cursor to its x value
+	m_xUnderMouse = series.isEmpty() ? std::numeric_limits<qreal>::quiet_NaN() : chart()->mapToValue(chart_position, series.first()).x();
+	std::size_t seriesIndex = 0;
 	for (auto const& series_i : series) {
+		std::size_t index = 2 * seriesIndex++;
 		if (DO_DEBUG) std::cerr << "Working on series " << series_i->name().toStdString() << "..." << std::endl;
 		QPen pen2 = QPen(QColor("black"));
 		pen2.setWidth(8);
@@ -148,36 +271,31 @@ void ChartView::drawForeground(QPainter* painter, QRectF const&) {
 
 		QPointF const value_at_position = chart()->mapToValue(chart_position, series_i);
 
-		// find the nearest points
-		qreal min_distance_left = std::numeric_limits<qreal>::max();
-		qreal min_distance_right = std::numeric_limits<qreal>::max();
+		// Find the nearest points in the full resolution data (the series only holds a decimated copy).
+		// x is sorted, so this is a binary search and independent of the number of points.
+		auto const seriesData = m_seriesData.find(series_i);
+		if (seriesData == m_seriesData.cend()) continue;
+		auto const& data = seriesData->second;
+		std::vector<double> const& dataX = *data.x;
+
 		std::optional<QPointF> nearest_point_left = std::nullopt;
 		std::optional<QPointF> nearest_point_right = std::nullopt;
 		std::optional<QPointF> exact_point = std::nullopt;
-		QLineSeries* ls = static_cast<QLineSeries*>(series_i);
 		QPointF valuePoint;
-		for (auto const& p_i : ls->points()) {
-			if (p_i.x() > value_at_position.x()) {
-				if (p_i.x() - value_at_position.x() < min_distance_right) {
-					min_distance_right = p_i.x() - value_at_position.x();
-					nearest_point_right = p_i;
-				}
-			}
-			else if (p_i.x() < value_at_position.x()) {
-				if (value_at_position.x() - p_i.x() < min_distance_right) {
-					min_distance_left = value_at_position.x() - p_i.x();
-					nearest_point_left = p_i;
-					valuePoint = p_i;
-				}
-				else {
-					exact_point = p_i;
-					valuePoint = p_i;
-					nearest_point_left = std::nullopt;
-					nearest_point_right = std::nullopt;
-					break;
-				}
+		auto const it = std::lower_bound(dataX.cbegin(), dataX.cbegin() + static_cast<std::ptrdiff_t>(data.y.size()), value_at_position.x());
+		std::size_t const k = static_cast<std::size_t>(it - dataX.cbegin());
+		// Missing values have no point to show
+		if (k < data.y.size() && dataX[k] == value_at_position.x()) {
+			if (!std::isnan(data.y[k])) {
+				exact_point = QPointF(dataX[k], data.y[k]);
+				valuePoint = exact_point.value();
 			}
 		}
+		else if (k > 0 && k < data.y.size() && !std::isnan(data.y[k - 1]) && !std::isnan(data.y[k])) {
+			nearest_point_left = QPointF(dataX[k - 1], data.y[k - 1]);
+			nearest_point_right = QPointF(dataX[k], data.y[k]);
+			valuePoint = nearest_point_left.value();
+		}
 
 		auto const drawFunc = [&](QPointF const& mappedPoint, QPointF const& valuePoint) {
 			m_values[index++] = valuePoint.x();
@@ -2,8 +2,12 @@
 
 #include <QChartView>
 #include <QRubberBand>
+#include <QXYSeries>
 
+#include <map>
+#include <memory>
 #include <optional>
+#include <span>
 #include <vector>
 
 class ChartView : public QChartView {
@@ -13,9 +17,32 @@ public:
 
     virtual ~ChartView();
 
+    // x and y of every series at the cursor, in the order of the series of the chart. NaN for series without a point there.
     std::vector<qreal> const& getValuesUnderMouse() const {
         return m_values;
     }
+    // The position of the cursor on the x axis, whether or not any series has a point there.
+    qreal getXUnderMouse() const {
+        return m_xUnderMouse;
+    }
+
+    // Sets the full resolution data of a series, sorted by x. The series itself only receives a decimated copy
+    // of the currently visible range with about two points per pixel, while the cursor readout uses the full data.
+    // Nothing is copied: x can be shared by several series, and y has to stay valid until the series is set again or removed.
+    // Points with a NaN y are skipped.
+    void setSeriesData(QXYSeries* series, std::shared_ptr<std::vector<double> const> x, std::span<double const> y);
+    // Replaces only the x values of a series, e.g. when switching the x axis between time and distance. y has to fit the new x as well.
+    // Nothing is decimated until the next redecimate(), so all series can be switched first.
+    void setSeriesX(QXYSeries* series, std::shared_ptr<std::vector<double> const> x);
+    // Forgets the data of a series, to be called before it is deleted.
+    void removeSeriesData(QXYSeries* series);
+
+    // Shows the latest duration of every traced stage (see Trace) in the top left corner, incl. the time of the last frame.
+    void setTimingOverlayVisible(bool isVisible);
+
+public slots:
+    // Re-decimates all series for the currently visible range, to be called whenever that changes.
+    void redecimate();
 
 signals:
     void newValuesUnderMouse();
@@ -25,11 +52,27 @@ protected:
     void mouseMoveEvent(QMouseEvent* event);
     void mouseReleaseEvent(QMouseEvent* event);
     void keyPressEvent(QKeyEvent* event);
+    void paintEvent(QPaintEvent* event) override;
     
     void drawForeground(QPainter* painter, QRectF const& rect) override;
 private:
+    struct SeriesData {
+        std::shared_ptr<std::vector<double> const> x;
+        std::span<double const> y;
+    };
+
     bool m_isTouching = false;
+    bool m_showTimingOverlay = false;
     QChart* m_chart;
     std::vector<qreal> m_values;
+    qreal m_xUnderMouse = 0.0;
     std::optional<QPointF> m_cursorPos = std::nullopt;
+    std::map<QAbstractSeries*, SeriesData> m_seriesData;
+    // Scratch buffers for decimating, shared by all series
+    std::vector<double> m_visibleX;
+    std::vector<double> m_visibleY;
+    std::vector<std::size_t> m_selectedIndices;
+
+    void decimateSeries(QXYSeries* series, SeriesData const& data);
+    void drawTimingOverlay(QPainter* painter);
 };
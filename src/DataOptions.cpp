@@ -13,6 +13,10 @@ DataOptions::DataOptions(QWidget *parent)
         QMessageBox::critical(this, "Internal Error", "Failed to connect signal checkStateChanged in DataOptions!");
         throw;
     }
+    if (!QObject::connect(ui->combo_filter, SIGNAL(currentIndexChanged(int)), this, SLOT(OnComboFilterIndexChanged(int)))) {
+        QMessageBox::critical(this, "Internal Error", "Failed to connect signal currentIndexChanged in DataOptions!");
+        throw;
+    }
     if (!QObject::connect(ui->sbox_window, SIGNAL(valueChanged(int)), this, SLOT(OnSBoxValueChanged(int)))) {
         QMessageBox::critical(this, "Internal Error", "Failed to connect signal valueChanged in DataOptions!");
         throw;
@@ -36,6 +40,7 @@ DataOptions::~DataOptions()
 
 void DataOptions::updateData() {
     m_data.show = ui->cbox_show->isChecked();
+    m_data.filterType = static_cast<FilterType>(ui->combo_filter->currentIndex());
     m_data.windowSize = ui->sbox_window->value();
     m_data.cutoffMin = ui->dsbox_min->value();
     m_data.cutoffMax = ui->dsbox_max->value();
@@ -46,6 +51,11 @@ void DataOptions::OnCBoxCheckStateChanged(int state) {
     emit optionsChanged(this);
 }
 
+void DataOptions::OnComboFilterIndexChanged(int index) {
+    m_data.filterType = static_cast<FilterType>(index);
+    emit optionsChanged(this);
+}
+
 void DataOptions::OnSBoxValueChanged(int value) {
     m_data.windowSize = value;
     emit optionsChanged(this);
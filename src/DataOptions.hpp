@@ -3,6 +3,8 @@
 #include <QGroupBox>
 #include <QLineSeries>
 
+#include "SeriesOptions.hpp"
+
 namespace Ui {
 class DataOptions;
 }
@@ -15,20 +17,14 @@ public:
     explicit DataOptions(QWidget* parent = nullptr);
     virtual ~DataOptions();
 
-    struct Data {
-        bool show;
-        int windowSize;
-        double cutoffMin;
-        double cutoffMax;
-
-        Data() : show(false), windowSize(1), cutoffMin(0.0), cutoffMax(999.0) {}
-    };
+    using Data = SeriesOptions;
     Data const& getData() const {
         return m_data;
     }
 
 public slots:
     void OnCBoxCheckStateChanged(int state);
+    void OnComboFilterIndexChanged(int index);
     void OnSBoxValueChanged(int value);
     void OnDBoxMinValueChanged(double value);
     void OnDBoxMaxValueChanged(double value);
@@ -0,0 +1,60 @@
+#include "Decimation.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void DecimateLttb(std::span<double const> x, std::span<double const> y, std::size_t threshold, std::vector<std::size_t>& selected) {
+	std::size_t const size = x.size();
+	selected.clear();
+	if (threshold >= size || threshold < 3) {
+		selected.reserve(size);
+		for (std::size_t i = 0; i < size; ++i) {
+			selected.push_back(i);
+		}
+		return;
+	}
+
+	selected.reserve(threshold);
+	// First and last point are always kept, the remaining ones are distributed evenly into threshold - 2 buckets
+	double const bucketSize = static_cast<double>(size - 2) / static_cast<double>(threshold - 2);
+	std::size_t a = 0;
+	selected.push_back(a);
+
+	for (std::size_t bucket = 0; bucket < threshold - 2; ++bucket) {
+		// Average of the next bucket, serving as the third corner of the triangle
+		std::size_t const nextStart = static_cast<std::size_t>(std::floor(static_cast<double>(bucket + 1) * bucketSize)) + 1;
+		std::size_t const nextEnd = std::min(static_cast<std::size_t>(std::floor(static_cast<double>(bucket + 2) * bucketSize)) + 1, size);
+		double averageX = 0.0;
+		double averageY = 0.0;
+		for (std::size_t i = nextStart; i < nextEnd; ++i) {
+			averageX += x[i];
+			averageY += y[i];
+		}
+		std::size_t const nextCount = nextEnd - nextStart;
+		if (nextCount > 0) {
+			averageX /= static_cast<double>(nextCount);
+			averageY /= static_cast<double>(nextCount);
+		} else {
+			averageX = x[size - 1];
+			averageY = y[size - 1];
+		}
+
+		std::size_t const start = static_cast<std::size_t>(std::floor(static_cast<double>(bucket) * bucketSize)) + 1;
+		std::size_t const end = std::min(static_cast<std::size_t>(std::floor(static_cast<double>(bucket + 1) * bucketSize)) + 1, size - 1);
+		double maxArea = -1.0;
+		std::size_t maxIndex = start;
+		for (std::size_t i = start; i < end; ++i) {
+			// Twice the triangle area, the factor does not matter for the comparison
+			double const area = std::abs((x[a] - averageX) * (y[i] - y[a]) - (x[a] - x[i]) * (averageY - y[a]));
+			if (area > maxArea) {
+				maxArea = area;
+				maxIndex = i;
+			}
+		}
+
+		selected.push_back(maxIndex);
+		a = maxIndex;
+	}
+
+	selected.push_back(size - 1);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Largest-Triangle-Three-Buckets downsampling (Steinarsson, 2013) of the points (x[i], y[i]), which have to be sorted by x.
+// Keeps the first and last point and from every bucket in between the point spanning the largest triangle with its neighbours,
+// which preserves peaks far better than picking every n-th point.
+// Writes the indices of the selected points (relative to the given spans) into selected, replacing its contents.
+// If there are not more than threshold points (or threshold is below 3), all of them are selected.
+void DecimateLttb(std::span<double const> x, std::span<double const> y, std::size_t threshold, std::vector<std::size_t>& selected);
@@ -0,0 +1,117 @@
+#include "DerivedSeries.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "SeriesKernels.hpp"
+#include "Trace.hpp"
+
+void ComputeSpeed(Track const& track, std::span<double> speed, bool doDebugOutput) {
+	TRACE_SCOPE("Speed");
+	if (track.Size() < 2) return;
+	ComputeSpeedKernel(track.GetTimeMs(), track.GetDistanceMeters(), track.GetDistanceValidity().GetWords(), KILOMETERS_PER_HOUR_TO_METERS_PER_SECOND(3.6), speed);
+
+	if (doDebugOutput) {
+		auto const ignored = std::count_if(speed.begin(), speed.end(), [](double value) { return std::isnan(value); });
+		std::cerr << "Ignoring " << ignored << " of " << speed.size() << " speeds because of low speed, missing distance or invalid time jump." << std::endl;
+	}
+}
+
+void ComputePositionSpeed(Track const& track, std::span<double const> latitudeDegrees, std::span<double const> longitudeDegrees, std::span<double> speed) {
+	TRACE_SCOPE("GPS speed");
+	if (track.Size() < 2) return;
+	ComputePositionSpeedKernel(track.GetTimeMs(), latitudeDegrees, longitudeDegrees, track.GetPositionValidity().GetWords(), KILOMETERS_PER_HOUR_TO_METERS_PER_SECOND(3.6), speed);
+}
+
+void DerivedSeries::Invalidate() {
+	m_isValid = false;
+}
+
+std::size_t DerivedSeries::GetMemoryUsage() const {
+	std::size_t result = m_resampledTrack.GetMemoryUsage() + m_heartRate.capacity() * sizeof(double);
+	for (auto const& c : m_columns) {
+		result += c.capacity() * sizeof(double);
+	}
+	return result;
+}
+
+void DerivedSeries::Compute(Track const& track, DerivationOptions const& options) {
+	Invalidate();
+	Update(track, options);
+}
+
+void DerivedSeries::updateFiltered(std::span<double const> input, SeriesOptions const& options, std::span<double> output) {
+	TRACE_SCOPE("Filter");
+	m_filter.Apply(input, options, output);
+}
+
+void DerivedSeries::updateSpeed(SpeedSource speedSource) {
+	auto const speed = getColumn(SeriesColumn::Speed);
+	switch (speedSource) {
+		case SpeedSource::Positions:
+			ComputePositionSpeed(m_resampledTrack, m_resampledTrack.GetLatitudeDegrees(), m_resampledTrack.GetLongitudeDegrees(), speed);
+			break;
+		case SpeedSource::SmoothedPositions:
+			m_positionSmoother.Apply(m_resampledTrack);
+			ComputePositionSpeed(m_resampledTrack, m_positionSmoother.GetLatitudeDegrees(), m_positionSmoother.GetLongitudeDegrees(), speed);
+			break;
+		case SpeedSource::Distance:
+		default:
+			ComputeSpeed(m_resampledTrack, speed, false);
+			break;
+	}
+	ScaleKernel(speed, METERS_PER_SECOND_TO_KILOMETERS_PER_HOUR(1.0), getColumn(SeriesColumn::SpeedKmh));
+}
+
+SeriesColumnSet DerivedSeries::Update(Track const& track, DerivationOptions const& options) {
+	TRACE_SCOPE("Derive series");
+	auto const column = [](SeriesColumn c) { return static_cast<std::size_t>(c); };
+	SeriesColumnSet recomputed;
+
+	// A different grid changes every row
+	if (m_isValid && !options.resample.HasSameComputation(m_lastOptions.resample)) {
+		Invalidate();
+	}
+
+	if (!m_isValid) {
+		Resample(track, options.resample, m_resampledTrack);
+		++m_gridGeneration;
+		m_size = (m_resampledTrack.Size() > 0) ? (m_resampledTrack.Size() - 1) : 0;
+		for (auto& c : m_columns) {
+			c.resize(m_size);
+		}
+		m_heartRate.resize(m_size);
+		ValidBytesToDoubleKernel(std::span<std::uint8_t const>(m_resampledTrack.GetHeartRateBpm().data(), m_size), m_resampledTrack.GetHeartRateValidity().GetWords(), m_heartRate);
+	}
+	if (!m_isValid || options.speedSource != m_lastOptions.speedSource) {
+		updateSpeed(options.speedSource);
+		recomputed.set(column(SeriesColumn::Speed));
+		recomputed.set(column(SeriesColumn::SpeedKmh));
+	}
+
+	// Dependencies: Speed -> AvgSpeed -> Pace -> AvgPace, SpeedKmh -> AvgSpeedKmh, heart rate -> AvgHeartRate
+	if (recomputed.test(column(SeriesColumn::Speed)) || !options.avgSpeed.HasSameComputation(m_lastOptions.avgSpeed)) {
+		updateFiltered(GetColumn(SeriesColumn::Speed), options.avgSpeed, getColumn(SeriesColumn::AvgSpeed));
+		recomputed.set(column(SeriesColumn::AvgSpeed));
+
+		SpeedToPaceKernel(GetColumn(SeriesColumn::AvgSpeed), getColumn(SeriesColumn::Pace));
+		recomputed.set(column(SeriesColumn::Pace));
+	}
+	if (recomputed.test(column(SeriesColumn::Pace)) || !options.pace.HasSameComputation(m_lastOptions.pace)) {
+		updateFiltered(GetColumn(SeriesColumn::Pace), options.pace, getColumn(SeriesColumn::AvgPace));
+		recomputed.set(column(SeriesColumn::AvgPace));
+	}
+	if (recomputed.test(column(SeriesColumn::SpeedKmh)) || !options.avgSpeedKmh.HasSameComputation(m_lastOptions.avgSpeedKmh)) {
+		updateFiltered(GetColumn(SeriesColumn::SpeedKmh), options.avgSpeedKmh, getColumn(SeriesColumn::AvgSpeedKmh));
+		recomputed.set(column(SeriesColumn::AvgSpeedKmh));
+	}
+	if (!m_isValid || !options.heartRate.HasSameComputation(m_lastOptions.heartRate)) {
+		updateFiltered(m_heartRate, options.heartRate, getColumn(SeriesColumn::AvgHeartRate));
+		recomputed.set(column(SeriesColumn::AvgHeartRate));
+	}
+
+	m_lastOptions = options;
+	m_isValid = true;
+	return recomputed;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "PositionSmoother.hpp"
+#include "Resampler.hpp"
+#include "SeriesFilters.hpp"
+#include "SeriesOptions.hpp"
+#include "Track.hpp"
+
+enum class SeriesColumn : std::size_t {
+	Speed = 0,
+	AvgSpeed,
+	AvgHeartRate,
+	Pace,
+	AvgPace,
+	SpeedKmh,
+	AvgSpeedKmh,
+	COUNT
+};
+
+using SeriesColumnSet = std::bitset<static_cast<std::size_t>(SeriesColumn::COUNT)>;
+
+// Where the speed (and everything derived from it) comes from.
+enum class SpeedSource {
+	// The distance recorded by the device
+	Distance = 0,
+	// The distance between the GPS positions
+	Positions,
+	// The distance between the GPS positions after smoothing them with PositionSmoother
+	SmoothedPositions
+};
+
+struct DerivationOptions {
+	ResampleOptions resample;
+	SpeedSource speedSource = SpeedSource::Distance;
+	SeriesOptions avgSpeed;
+	SeriesOptions avgSpeedKmh;
+	SeriesOptions heartRate;
+	SeriesOptions pace;
+};
+
+// The series computed from a Track for display, one named column each.
+// The track is resampled onto a uniform grid first (see Resample()), so the filter windows can count in samples no matter how the device recorded.
+// Row i belongs to sample i of GetResampledTrack(). As speed needs the following sample, there is one row less than that track has samples.
+// Missing values are NaN. The column buffers are kept between calls, so recomputing does not allocate.
+class DerivedSeries {
+public:
+	// Recomputes everything.
+	void Compute(Track const& track, DerivationOptions const& options);
+	// Recomputes only the columns whose options (or whose inputs) changed since the last call and returns them.
+	// The track is assumed to be the same as in the last call, call Invalidate() when it is not.
+	SeriesColumnSet Update(Track const& track, DerivationOptions const& options);
+	void Invalidate();
+	// False until the next call of Compute() or Update() after Invalidate().
+	inline bool IsValid() const {
+		return m_isValid;
+	}
+
+	inline std::size_t Size() const {
+		return m_size;
+	}
+	inline std::span<double const> GetColumn(SeriesColumn column) const {
+		return std::span<double const>(m_columns[static_cast<std::size_t>(column)].data(), m_size);
+	}
+	// The track on the grid the rows belong to, e.g. for their times.
+	inline Track const& GetResampledTrack() const {
+		return m_resampledTrack;
+	}
+	// Changes whenever the rows are put on a new grid (a new track or other resampling options), so anything kept per row can tell
+	// whether it is outdated. 0 before the first call of Compute() or Update().
+	inline std::uint64_t GetGridGeneration() const {
+		return m_gridGeneration;
+	}
+	// Bytes held by the resampled track and the columns, without the scratch buffers of the filters.
+	std::size_t GetMemoryUsage() const;
+private:
+	std::size_t m_size = 0;
+	Track m_resampledTrack;
+	std::array<std::vector<double>, static_cast<std::size_t>(SeriesColumn::COUNT)> m_columns;
+	std::vector<double> m_heartRate;
+	SeriesFilter m_filter;
+	PositionSmoother m_positionSmoother;
+
+	bool m_isValid = false;
+	std::uint64_t m_gridGeneration = 0;
+	DerivationOptions m_lastOptions;
+
+	inline std::span<double> getColumn(SeriesColumn column) {
+		return std::span<double>(m_columns[static_cast<std::size_t>(column)].data(), m_size);
+	}
+	void updateSpeed(SpeedSource speedSource);
+	void updateFiltered(std::span<double const> input, SeriesOptions const& options, std::span<double> output);
+};
+
+static inline double METERS_PER_SECOND_TO_KILOMETERS_PER_HOUR(double metersPerSecond) {
+	return metersPerSecond * 3.6;
+}
+
+static inline double KILOMETERS_PER_HOUR_TO_METERS_PER_SECOND(double kilometersPerHour) {
+	return kilometersPerHour / 3.6;
+}
+
+// Speed in m/s between sample i and i + 1, written to speed[i]. speed has to hold track.Size() - 1 values.
+// Speeds of 3.6 km/h and below count as standing and are NaN, as are those of samples not strictly increasing in time.
+void ComputeSpeed(Track const& track, std::span<double> speed, bool doDebugOutput);
+// Like ComputeSpeed(), but from the great circle distance between the given positions of the samples (e.g. smoothed ones) instead of the recorded distance.
+// The positions have to be as many as the track has samples, their validity is that of the track's positions.
+void ComputePositionSpeed(Track const& track, std::span<double const> latitudeDegrees, std::span<double const> longitudeDegrees, std::span<double> speed);
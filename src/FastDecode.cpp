@@ -0,0 +1,121 @@
+#include "FastDecode.hpp"
+
+#include <charconv>
+#include <cstdio>
+
+bool DecodeDouble(std::string_view text, double& value) {
+	if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+	if (text.empty()) return false;
+
+	auto const result = std::from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == std::errc() && result.ptr == (text.data() + text.size());
+}
+
+bool DecodeInteger(std::string_view text, int& value) {
+	if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+	if (text.empty()) return false;
+
+	auto const result = std::from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == std::errc() && result.ptr == (text.data() + text.size());
+}
+
+static inline bool DecodeFixedDigits(std::string_view text, std::size_t offset, std::size_t count, int& value) {
+	if (offset + count > text.size()) return false;
+	value = 0;
+	for (std::size_t i = offset; i < offset + count; ++i) {
+		char const c = text[i];
+		if (c < '0' || c > '9') return false;
+		value = value * 10 + (c - '0');
+	}
+	return true;
+}
+
+// Days since 1970-01-01 for a date in the proleptic Gregorian calendar, see http://howardhinnant.github.io/date_algorithms.html
+static inline std::int64_t DaysFromCivil(int year, int month, int day) {
+	year -= (month <= 2) ? 1 : 0;
+	std::int64_t const era = (year >= 0 ? year : year - 399) / 400;
+	std::int64_t const yearOfEra = year - era * 400;
+	std::int64_t const dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	std::int64_t const dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+// Inverse of DaysFromCivil
+static inline void CivilFromDays(std::int64_t days, int& year, int& month, int& day) {
+	days += 719468;
+	std::int64_t const era = (days >= 0 ? days : days - 146096) / 146097;
+	std::int64_t const dayOfEra = days - era * 146097;
+	std::int64_t const yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	std::int64_t const dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	std::int64_t const monthPrime = (5 * dayOfYear + 2) / 153;
+	day = static_cast<int>(dayOfYear - (153 * monthPrime + 2) / 5 + 1);
+	month = static_cast<int>(monthPrime < 10 ? monthPrime + 3 : monthPrime - 9);
+	year = static_cast<int>(yearOfEra + era * 400 + (month <= 2 ? 1 : 0));
+}
+
+static inline bool IsLeapYear(int year) {
+	return (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
+}
+
+std::optional<std::int64_t> DecodeIsoTimestamp(std::string_view text) {
+	// 0123456789012345678
+	// YYYY-MM-DDTHH:MM:SS
+	int year, month, day, hour, minute, second;
+	if (text.size() < 20) return std::nullopt;
+	if (!DecodeFixedDigits(text, 0, 4, year) || text[4] != '-' || !DecodeFixedDigits(text, 5, 2, month) || text[7] != '-' || !DecodeFixedDigits(text, 8, 2, day)) return std::nullopt;
+	if ((text[10] != 'T' && text[10] != 't') || !DecodeFixedDigits(text, 11, 2, hour) || text[13] != ':' || !DecodeFixedDigits(text, 14, 2, minute) || text[16] != ':' || !DecodeFixedDigits(text, 17, 2, second)) return std::nullopt;
+
+	static constexpr int DAYS_PER_MONTH[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	if (month < 1 || month > 12 || day < 1 || hour > 23 || minute > 59 || second > 59) return std::nullopt;
+	if (day > DAYS_PER_MONTH[month - 1] + ((month == 2 && IsLeapYear(year)) ? 1 : 0)) return std::nullopt;
+
+	std::size_t pos = 19;
+	int milliseconds = 0;
+	if (text[pos] == '.' || text[pos] == ',') {
+		++pos;
+		std::size_t digits = 0;
+		while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+			if (digits < 3) milliseconds = milliseconds * 10 + (text[pos] - '0');
+			++digits;
+			++pos;
+		}
+		if (digits == 0) return std::nullopt;
+		for (; digits < 3; ++digits) milliseconds *= 10;
+	}
+
+	int offsetMinutes = 0;
+	if (pos >= text.size()) {
+		return std::nullopt;
+	} else if (text[pos] == 'Z' || text[pos] == 'z') {
+		++pos;
+	} else if (text[pos] == '+' || text[pos] == '-') {
+		int const sign = (text[pos] == '-') ? -1 : 1;
+		int offsetHours, offsetMinutesPart;
+		if (!DecodeFixedDigits(text, pos + 1, 2, offsetHours)) return std::nullopt;
+		pos += 3;
+		if (pos < text.size() && text[pos] == ':') ++pos;
+		if (!DecodeFixedDigits(text, pos, 2, offsetMinutesPart)) return std::nullopt;
+		pos += 2;
+		if (offsetHours > 23 || offsetMinutesPart > 59) return std::nullopt;
+		offsetMinutes = sign * (offsetHours * 60 + offsetMinutesPart);
+	} else {
+		return std::nullopt;
+	}
+	if (pos != text.size()) return std::nullopt;
+
+	std::int64_t const days = DaysFromCivil(year, month, day);
+	std::int64_t const seconds = days * 86400 + hour * 3600 + minute * 60 + second - offsetMinutes * 60;
+	return seconds * 1000 + milliseconds;
+}
+
+std::string EncodeIsoTimestamp(std::int64_t epochMs) {
+	std::int64_t const milliseconds = ((epochMs % 1000) + 1000) % 1000;
+	std::int64_t const seconds = (epochMs - milliseconds) / 1000;
+	std::int64_t const secondOfDay = ((seconds % 86400) + 86400) % 86400;
+	int year, month, day;
+	CivilFromDays((seconds - secondOfDay) / 86400, year, month, day);
+
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", year, month, day, static_cast<int>(secondOfDay / 3600), static_cast<int>((secondOfDay / 60) % 60), static_cast<int>(secondOfDay % 60), static_cast<int>(milliseconds));
+	return std::string(buffer);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Locale independent, allocation free decoding of the values found in TCX files.
+// These run once or more per field of every trackpoint, so they work directly on views into the mapped file.
+
+// Accepts an optional leading '+' in addition to what std::from_chars accepts. The whole text has to be consumed.
+bool DecodeDouble(std::string_view text, double& value);
+bool DecodeInteger(std::string_view text, int& value);
+
+// Decodes "YYYY-MM-DDTHH:MM:SS[.fraction](Z|+HH:MM|-HH:MM|+HHMM|-HHMM)" into milliseconds since the epoch (UTC).
+// Fractions beyond milliseconds are truncated. Timestamps without a zone designator are rejected, as their meaning depends on the local time zone.
+std::optional<std::int64_t> DecodeIsoTimestamp(std::string_view text);
+
+// The inverse of DecodeIsoTimestamp, always in UTC and with milliseconds: "YYYY-MM-DDTHH:MM:SS.mmmZ".
+std::string EncodeIsoTimestamp(std::int64_t epochMs);
@@ -0,0 +1,201 @@
+#include "LibraryDialog.hpp"
+#include "ui_LibraryDialog.h"
+
+#include <cmath>
+#include <exception>
+#include <system_error>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDialogButtonBox>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QPushButton>
+#include <QTimer>
+
+#include "BatchLoader.hpp"
+
+enum LibraryColumn : int {
+	COLUMN_DATE = 0,
+	COLUMN_SPORT,
+	COLUMN_DURATION,
+	COLUMN_DISTANCE,
+	COLUMN_PACE,
+	COLUMN_AVG_HEART_RATE,
+	COLUMN_MAX_HEART_RATE,
+	COLUMN_FILE,
+	COLUMN_COUNT
+};
+
+LibraryDialog::LibraryDialog(QString const& directory, bool doDebugOutput, ParserBackend backend, QWidget* parent)
+	: QDialog(parent)
+	, ui(new Ui::LibraryDialog)
+	, m_doDebugOutput(doDebugOutput)
+	, m_backend(backend)
+	, m_index(ActivityIndex::Read(directory.toStdString()))
+{
+	ui->setupUi(this);
+	setWindowTitle(QString("Library - %1").arg(directory));
+
+	ui->table_activities->setColumnCount(COLUMN_COUNT);
+	ui->table_activities->setHorizontalHeaderLabels({ "Date", "Sport", "Duration", "Distance in km", "Pace in min/km", "Avg. Heartrate", "Max. Heartrate", "File" });
+
+	if (!QObject::connect(ui->btn_update, SIGNAL(clicked()), this, SLOT(UpdateIndex()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for updating the library!");
+		throw;
+	}
+	if (!QObject::connect(ui->ledit_filter, SIGNAL(textChanged(QString)), this, SLOT(ApplyFilter()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for filtering the library!");
+		throw;
+	}
+	if (!QObject::connect(ui->table_activities, SIGNAL(itemSelectionChanged()), this, SLOT(OnSelectionChanged()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for selecting an activity!");
+		throw;
+	}
+	if (!QObject::connect(ui->table_activities, SIGNAL(itemDoubleClicked(QTableWidgetItem*)), this, SLOT(OnItemDoubleClicked(QTableWidgetItem*)))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for opening an activity!");
+		throw;
+	}
+	if (!QObject::connect(ui->buttonBox, SIGNAL(accepted()), this, SLOT(accept())) || !QObject::connect(ui->buttonBox, SIGNAL(rejected()), this, SLOT(reject()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for the dialog buttons!");
+		throw;
+	}
+
+	FillTable();
+
+	// A directory without an index has to be indexed once, after the dialog is shown so the progress has something to go on top of
+	std::error_code error;
+	if (!std::filesystem::exists(ActivityIndex::GetIndexPath(m_index.GetDirectory()), error)) {
+		QTimer::singleShot(0, this, SLOT(UpdateIndex()));
+	}
+}
+
+LibraryDialog::~LibraryDialog()
+{
+	delete ui;
+}
+
+QString LibraryDialog::GetSelectedFile() const {
+	int const row = ui->table_activities->currentRow();
+	if (row < 0 || ui->table_activities->isRowHidden(row)) {
+		return QString();
+	}
+	return ui->table_activities->item(row, COLUMN_FILE)->data(Qt::UserRole).toString();
+}
+
+void LibraryDialog::UpdateIndex() {
+	QProgressDialog progress("Indexing activities...", "Cancel", 0, 0, this);
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setMinimumDuration(500);
+
+	// Called on this thread after every parsed file and regularly while waiting for the next one, which keeps the GUI alive in between
+	auto const progressCallback = [&](std::size_t filesDone, std::size_t filesTotal) {
+		progress.setMaximum(static_cast<int>(filesTotal));
+		progress.setValue(static_cast<int>(filesDone));
+		QCoreApplication::processEvents();
+		return !progress.wasCanceled();
+	};
+
+	ActivityIndex::UpdateStatistics statistics;
+	try {
+		statistics = m_index.Update(BatchLoader(), m_doDebugOutput, m_backend, progressCallback);
+	}
+	catch (std::exception const& e) {
+		QMessageBox::critical(this, "Error", QString("Failed to update the library:\n%1").arg(QString::fromStdString(e.what())));
+		return;
+	}
+	progress.reset();
+
+	try {
+		m_index.Write();
+	}
+	catch (std::exception const& e) {
+		QMessageBox::warning(this, "Warning", QString("Failed to save the library index, it will be rebuilt next time:\n%1").arg(QString::fromStdString(e.what())));
+	}
+
+	FillTable();
+	ui->label_status->setText(QString("%1 activities (%2 new, %3 changed, %4 removed, %5 failed)%6.")
+		.arg(static_cast<qulonglong>(m_index.GetEntries().size())).arg(static_cast<qulonglong>(statistics.added)).arg(static_cast<qulonglong>(statistics.changed))
+		.arg(static_cast<qulonglong>(statistics.removed)).arg(static_cast<qulonglong>(statistics.failed))
+		.arg(statistics.wasCancelled ? QString(", cancelled") : QString()));
+}
+
+void LibraryDialog::FillTable() {
+	QTableWidget* table = ui->table_activities;
+	// Sorting while filling would move rows under our feet
+	table->setSortingEnabled(false);
+	table->clearContents();
+	table->setRowCount(static_cast<int>(m_index.GetEntries().size()));
+
+	auto const setNumber = [&](int row, int column, double value, int precision) {
+		QTableWidgetItem* item = new QTableWidgetItem();
+		if (!std::isnan(value)) {
+			double const scale = std::pow(10.0, precision);
+			item->setData(Qt::DisplayRole, std::round(value * scale) / scale);
+		}
+		table->setItem(row, column, item);
+	};
+
+	int row = 0;
+	for (auto const& entry : m_index.GetEntries()) {
+		ActivitySummary const& summary = entry.summary;
+
+		QTableWidgetItem* dateItem = new QTableWidgetItem();
+		if (entry.IsValid() && summary.trackpoints > 0) {
+			dateItem->setData(Qt::DisplayRole, QDateTime::fromMSecsSinceEpoch(summary.startTimeMs));
+		}
+		table->setItem(row, COLUMN_DATE, dateItem);
+		table->setItem(row, COLUMN_SPORT, new QTableWidgetItem(entry.IsValid() ? QString::fromStdString(entry.sport) : QString("Error")));
+
+		QTableWidgetItem* durationItem = new QTableWidgetItem();
+		if (!std::isnan(summary.durationSeconds)) {
+			// Zero padded, so sorting the text sorts by duration
+			qint64 const seconds = static_cast<qint64>(summary.durationSeconds);
+			durationItem->setText(QString("%1:%2:%3").arg(seconds / 3600, 2, 10, QChar('0')).arg((seconds / 60) % 60, 2, 10, QChar('0')).arg(seconds % 60, 2, 10, QChar('0')));
+		}
+		table->setItem(row, COLUMN_DURATION, durationItem);
+
+		setNumber(row, COLUMN_DISTANCE, summary.distanceMeters / 1000.0, 2);
+		setNumber(row, COLUMN_PACE, summary.movingPaceMinutesPerKilometer, 2);
+		setNumber(row, COLUMN_AVG_HEART_RATE, summary.avgHeartRateBpm, 0);
+		setNumber(row, COLUMN_MAX_HEART_RATE, summary.maxHeartRateBpm, 0);
+
+		QString const file = QString::fromStdString(entry.file.generic_string());
+		QTableWidgetItem* fileItem = new QTableWidgetItem(file);
+		fileItem->setData(Qt::UserRole, QString::fromStdString((m_index.GetDirectory() / entry.file).string()));
+		if (!entry.IsValid()) {
+			fileItem->setToolTip(QString::fromStdString(entry.errorMessage));
+		}
+		table->setItem(row, COLUMN_FILE, fileItem);
+		++row;
+	}
+
+	table->setSortingEnabled(true);
+	table->resizeColumnsToContents();
+	ui->label_status->setText(QString("%1 activities.").arg(static_cast<qulonglong>(m_index.GetEntries().size())));
+	ApplyFilter();
+}
+
+void LibraryDialog::ApplyFilter() {
+	QTableWidget* table = ui->table_activities;
+	QString const filter = ui->ledit_filter->text().trimmed();
+	for (int row = 0; row < table->rowCount(); ++row) {
+		bool matches = filter.isEmpty();
+		for (int column = 0; column < COLUMN_COUNT && !matches; ++column) {
+			QTableWidgetItem const* item = table->item(row, column);
+			matches = (item != nullptr) && item->text().contains(filter, Qt::CaseInsensitive);
+		}
+		table->setRowHidden(row, !matches);
+	}
+	OnSelectionChanged();
+}
+
+void LibraryDialog::OnSelectionChanged() {
+	ui->buttonBox->button(QDialogButtonBox::Open)->setEnabled(!GetSelectedFile().isEmpty());
+}
+
+void LibraryDialog::OnItemDoubleClicked(QTableWidgetItem*) {
+	if (!GetSelectedFile().isEmpty()) {
+		accept();
+	}
+}
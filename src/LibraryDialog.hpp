@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QDialog>
+#include <QString>
+#include <QTableWidgetItem>
+
+#include "ActivityIndex.hpp"
+#include "Parser.hpp"
+
+namespace Ui {
+class LibraryDialog;
+}
+
+// Lists all activities of a directory from its ActivityIndex, so they can be sorted, filtered and picked without parsing any of them.
+// The index is only brought up to date when asked to, or when the directory has none yet.
+class LibraryDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    LibraryDialog(QString const& directory, bool doDebugOutput, ParserBackend backend, QWidget* parent = nullptr);
+    virtual ~LibraryDialog();
+
+    // Full path of the chosen activity, empty if there is none.
+    QString GetSelectedFile() const;
+
+public slots:
+    void UpdateIndex();
+    void ApplyFilter();
+    void OnSelectionChanged();
+    void OnItemDoubleClicked(QTableWidgetItem* item);
+
+private:
+    Ui::LibraryDialog *ui;
+
+    bool const m_doDebugOutput;
+    ParserBackend const m_backend;
+    ActivityIndex m_index;
+
+    void FillTable();
+};
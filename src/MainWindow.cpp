@@ -2,22 +2,40 @@
 #include "ui_mainwindow.h"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <filesystem>
 #include <iostream>
-#include <tuple>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 
 #include <QChart>
+#include <QDateTime>
+#include <QActionGroup>
 #include <QDateTimeAxis>
 #include <QFileDialog>
 #include <QLineSeries>
 #include <QMessageBox>
+#include <QPen>
+#include <QStringList>
 #include <QTimer>
 #include <QValueAxis>
 
 #include "ChartView.hpp"
+#include "DerivedSeries.hpp"
+#include "LibraryDialog.hpp"
 #include "Parser.hpp"
+#include "Trace.hpp"
+#include "TrackLoader.hpp"
 
 static bool constexpr DO_DEBUG = false;
+// Switch to ParserBackend::Dom to compare against the old QDomDocument based parser.
+static ParserBackend constexpr PARSER_BACKEND = ParserBackend::Streaming;
+// Keeps parsed tracks in a binary cache next to the TCX file, so opening it again is nearly instant
+static bool constexpr USE_TRACK_CACHE = true;
 
 MainWindow::MainWindow(QWidget* parent)
 	: QMainWindow(parent)
@@ -30,6 +48,47 @@ MainWindow::MainWindow(QWidget* parent)
 		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for windowSize slider!");
 		throw;
 	}
+	if (!QObject::connect(ui->action_OpenLibrary, SIGNAL(triggered()), this, SLOT(SelectFromLibrary()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for opening the library!");
+		throw;
+	}
+	if (!QObject::connect(ui->action_CompareWith, SIGNAL(triggered()), this, SLOT(SelectComparedFiles()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for comparing files!");
+		throw;
+	}
+	if (!QObject::connect(ui->action_ClearComparison, SIGNAL(triggered()), this, SLOT(ClearComparison()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for clearing the comparison!");
+		throw;
+	}
+	if (!QObject::connect(ui->action_CancelLoading, SIGNAL(triggered()), this, SLOT(CancelLoading()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for cancelling the loading!");
+		throw;
+	}
+	if (!QObject::connect(ui->action_ShowTimings, SIGNAL(toggled(bool)), this, SLOT(ShowTimings(bool)))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for showing the timings!");
+		throw;
+	}
+	if (!QObject::connect(ui->action_ExportTrace, SIGNAL(triggered()), this, SLOT(ExportTrace()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for exporting the trace!");
+		throw;
+	}
+	// Only one speed source can be checked at a time
+	QActionGroup* speedSourceGroup = new QActionGroup(this);
+	for (QAction* action : { ui->action_SpeedFromDistance, ui->action_SpeedFromPositions, ui->action_SpeedFromSmoothedPositions }) {
+		speedSourceGroup->addAction(action);
+	}
+	if (!QObject::connect(speedSourceGroup, SIGNAL(triggered(QAction*)), this, SLOT(OnSpeedSourceChanged()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for the speed source!");
+		throw;
+	}
+	QActionGroup* alignmentGroup = new QActionGroup(this);
+	for (QAction* action : { ui->action_AlignByClockTime, ui->action_AlignByElapsedTime, ui->action_AlignByDistance }) {
+		alignmentGroup->addAction(action);
+	}
+	if (!QObject::connect(alignmentGroup, SIGNAL(triggered(QAction*)), this, SLOT(OnAlignmentChanged()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for the alignment!");
+		throw;
+	}
 	if (!QObject::connect(ui->gbox_avgSpeed, SIGNAL(optionsChanged(DataOptions*)), this, SLOT(OnDataOptionsChanged(DataOptions*)))) {
 		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for data options #1!");
 		throw;
@@ -47,6 +106,30 @@ MainWindow::MainWindow(QWidget* parent)
 		throw;
 	}
 
+	m_trackLoader = new TrackLoader(DO_DEBUG, PARSER_BACKEND, USE_TRACK_CACHE, this);
+	if (!QObject::connect(m_trackLoader, SIGNAL(loadProgress(quint64,qint64,qint64)), this, SLOT(OnLoadProgress(quint64,qint64,qint64)))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for loading progress!");
+		throw;
+	}
+	if (!QObject::connect(m_trackLoader, SIGNAL(loadFinished(quint64,qint64)), this, SLOT(OnLoadFinished(quint64,qint64)))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for finished loads!");
+		throw;
+	}
+	if (!QObject::connect(m_trackLoader, SIGNAL(loadFailed(quint64,QString)), this, SLOT(OnLoadFailed(quint64,QString)))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for failed loads!");
+		throw;
+	}
+	if (!QObject::connect(m_trackLoader, SIGNAL(loadCancelled(quint64)), this, SLOT(OnLoadCancelled(quint64)))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up connection for cancelled loads!");
+		throw;
+	}
+
+	m_loadProgress = new QProgressBar(this);
+	m_loadProgress->setRange(0, 1000);
+	m_loadProgress->setMaximumWidth(200);
+	m_loadProgress->setVisible(false);
+	ui->statusbar->addPermanentWidget(m_loadProgress);
+
 	QTimer::singleShot(250, this, SLOT(SelectNewFile()));
 }
 
@@ -58,22 +141,153 @@ MainWindow::~MainWindow()
 void MainWindow::SelectNewFile() {
 	QString const filename = QFileDialog::getOpenFileName(this, "Select TCX file to display", QString(), "Trackpoints (*.tcx)");
 
-	if (!filename.isNull()) {
-		m_selectedFile = filename.toStdString();
+	if (filename.isNull()) {
+		return;
+	}
+	LoadFile(filename);
+}
+
+void MainWindow::SelectFromLibrary() {
+	QString const directory = QFileDialog::getExistingDirectory(this, "Select directory of TCX files", m_libraryDirectory);
+	if (directory.isNull()) {
+		return;
+	}
+	m_libraryDirectory = directory;
+
+	LibraryDialog dialog(directory, DO_DEBUG, PARSER_BACKEND, this);
+	if (dialog.exec() != QDialog::Accepted || dialog.GetSelectedFile().isEmpty()) {
+		return;
+	}
+	LoadFile(dialog.GetSelectedFile());
+}
+
+void MainWindow::SelectComparedFiles() {
+	QStringList const filenames = QFileDialog::getOpenFileNames(this, "Select TCX files to compare with", QString(), "Trackpoints (*.tcx)");
+
+	// Files already shown are not loaded again
+	std::vector<std::filesystem::path> files;
+	for (auto const& filename : filenames) {
+		std::filesystem::path file(filename.toStdString());
+		if (!m_activities.Contains(file)) {
+			files.push_back(std::move(file));
+		}
+	}
+	if (files.empty()) {
+		return;
+	}
+
+	m_isLoadingComparedFiles = true;
+	m_loadGeneration = m_trackLoader->Load(files);
+	SetLoading(true);
+	ui->statusbar->showMessage(QString("Loading %1 files to compare...").arg(files.size()));
+}
+
+void MainWindow::ClearComparison() {
+	// Keeps the activity opened first
+	while (m_activities.Size() > 1) {
+		m_activities.Remove(m_activities.Size() - 1);
+	}
+	m_isSeriesOutdated = true;
+	UpdateChart();
+}
+
+void MainWindow::LoadFile(QString const& filename) {
+	m_selectedFile = filename.toStdString();
+	m_isLoadingComparedFiles = false;
+
+	// Starting a new load cancels the one still running, its results will not show up anymore
+	m_loadGeneration = m_trackLoader->Load(m_selectedFile);
+	SetLoading(true);
+	ui->statusbar->showMessage(QString("Loading '%1'...").arg(filename));
+}
+
+void MainWindow::CancelLoading() {
+	m_trackLoader->Cancel();
+}
+
+void MainWindow::ShowTimings(bool isEnabled) {
+	// Timings are only recorded while they are shown, so there is no overhead otherwise
+	Trace::SetEnabled(isEnabled);
+	if (m_chartView != nullptr) {
+		m_chartView->setTimingOverlayVisible(isEnabled);
+	}
+}
+
+void MainWindow::ExportTrace() {
+	if (Trace::GetEvents().empty()) {
+		QMessageBox::information(this, "Export Trace", "Nothing has been recorded yet. Enable View > Show Timings and load or explore a file first.");
+		return;
+	}
+	QString const filename = QFileDialog::getSaveFileName(this, "Export trace", "trace.json", "Chrome Trace (*.json)");
+	if (filename.isNull()) {
+		return;
+	}
+	try {
+		Trace::WriteChromeJson(std::filesystem::path(filename.toStdString()));
+	}
+	catch (std::exception const& e) {
+		QMessageBox::critical(this, "Error", QString("Failed to export the trace:\n%1").arg(QString::fromStdString(e.what())));
+		return;
+	}
+	ui->statusbar->showMessage(QString("Trace written to '%1', open it in chrome://tracing or Perfetto.").arg(filename));
+}
+
+void MainWindow::SetLoading(bool isLoading) {
+	m_loadProgress->setValue(0);
+	m_loadProgress->setVisible(isLoading);
+	ui->action_CancelLoading->setEnabled(isLoading);
+}
+
+void MainWindow::OnLoadProgress(quint64 generation, qint64 bytesDone, qint64 bytesTotal) {
+	if (generation != m_loadGeneration) return;
+	m_loadProgress->setValue((bytesTotal > 0) ? static_cast<int>((bytesDone * 1000) / bytesTotal) : 0);
+}
+
+void MainWindow::OnLoadFinished(quint64 generation, qint64 durationMs) {
+	if (generation != m_loadGeneration) return;
+	SetLoading(false);
+
+	if (m_isLoadingComparedFiles) {
+		QStringList errors;
+		for (auto& result : m_trackLoader->TakeResults(generation)) {
+			if (!result.track.has_value()) {
+				errors.append(QString("'%1': %2").arg(QString::fromStdString(result.file.string()), QString::fromStdString(result.errorMessage)));
+				continue;
+			}
+			m_activities.Add(result.file, std::move(result.track.value()));
+		}
+		if (!errors.isEmpty()) {
+			QMessageBox::critical(this, "Error", QString("Failed to parse some of the files to compare:\n%1").arg(errors.join('\n')));
+		}
 	}
 	else {
-		m_selectedFile = "";
+		auto track = m_trackLoader->TakeTrack(generation);
+		if (!track.has_value()) return;
+		m_activities.Clear();
+		m_activities.Add(m_selectedFile, std::move(track.value()));
 	}
+	m_lastParseDurationMs = durationMs;
+	m_isSeriesOutdated = true;
+	if (DO_DEBUG) std::cout << "Got " << m_activities.Size() << " activities from the input files, using " << m_activities.GetMemoryUsage() << " bytes." << std::endl;
 
 	UpdateChart();
 }
 
-static inline double METERS_PER_SECOND_TO_KILOMETERS_PER_HOUR(double metersPerSecond) {
-	return metersPerSecond * 3.6;
+void MainWindow::OnLoadFailed(quint64 generation, QString message) {
+	if (generation != m_loadGeneration) return;
+	SetLoading(false);
+	ui->statusbar->clearMessage();
+	if (m_isLoadingComparedFiles) {
+		QMessageBox::critical(this, "Error", QString("Failed to parse the files to compare:\n%1").arg(message));
+		return;
+	}
+	QMessageBox::critical(this, "Error", QString("Failed to parse '%1':\n%2").arg(QString::fromStdString(m_selectedFile), message));
 }
 
-static inline double KILOMETERS_PER_HOUR_TO_METERS_PER_SECOND(double kilometersPerHour) {
-	return kilometersPerHour / 3.6;
+void MainWindow::OnLoadCancelled(quint64 generation) {
+	if (generation != m_loadGeneration) return;
+	SetLoading(false);
+	ui->statusbar->showMessage("Loading was cancelled.");
 }
 
 std::string ToLower(std::string s) {
@@ -89,246 +303,312 @@ protected:
 	}
 };
 
-std::vector<std::tuple<Trackpoint, std::optional<double>>> GetSpeedFromTrackpoints(std::vector<Trackpoint> const& trackpoints) {
-	std::vector<std::tuple<Trackpoint, std::optional<double>>> result;
-
-	for (std::size_t i = 0; i < trackpoints.size(); ++i) {
-		if ((i + 1) >= trackpoints.size()) {
-			break;
-		}
-
-		auto const& tpA = trackpoints.at(i);
-		auto const& tpB = trackpoints.at(i + 1);
-
-		double const distanceTravelledInMeters = tpB.distanceMeters - tpA.distanceMeters;
-		double const timePassedInMilliseconds = tpB.dateTime.toMSecsSinceEpoch() - tpA.dateTime.toMSecsSinceEpoch();
-		double const speedInMetersPerSecond = distanceTravelledInMeters / (timePassedInMilliseconds / 1000.0);
+void MainWindow::UpdateChart() {
+	if (m_activities.Empty())
+		return;
 
-		if (timePassedInMilliseconds != 1000 && result.size() == 0) {
-			if (DO_DEBUG) std::cerr << "Ignoring starting point with invalid time jump!" << std::endl;
-			result.push_back(std::make_tuple(tpA, std::nullopt));
-			continue;
-		}
-		else if (speedInMetersPerSecond <= KILOMETERS_PER_HOUR_TO_METERS_PER_SECOND(3.6)) {
-			if (DO_DEBUG) std::cerr << "Ignoring point #" << i << " with low speed!" << std::endl;
-			result.push_back(std::make_tuple(tpA, std::nullopt));
-			continue;
-		}
+	TRACE_SCOPE("Update chart");
+	auto const timeStart = std::chrono::steady_clock::now();
+	std::size_t newPointCount = 0;
+	std::size_t newActivityCount = 0;
+	for (std::size_t i = 0; i < m_activities.Size(); ++i) {
+		auto const& activity = m_activities.Get(i);
+		if (activity.derivedSeries.IsValid()) continue;
+		newPointCount += activity.track.Size();
+		++newActivityCount;
+	}
 
-		if (timePassedInMilliseconds != 1000) {
-			std::cerr << "Assumption Error: Expected time to always be 1000ms, but it was " << timePassedInMilliseconds << "ms instead at point #" << i << "!" << std::endl;
-			throw;
-		}
+	// Only the series depending on the changed options are recomputed, for all activities in parallel
+	auto results = m_activities.Update(GetDerivationOptions());
+	auto const timeEnd = std::chrono::steady_clock::now();
 
-		result.push_back(std::make_tuple(tpA, speedInMetersPerSecond));
+	// Activities whose series could not be derived are dropped, from the back so the results stay in line with the activities
+	QStringList errors;
+	for (std::size_t i = results.size(); i-- > 0;) {
+		if (results[i].errorMessage.empty()) continue;
+		errors.prepend(QString("'%1': %2").arg(QString::fromStdString(m_activities.Get(i).file.string()), QString::fromStdString(results[i].errorMessage)));
+		m_activities.Remove(i);
+		results.erase(results.begin() + static_cast<std::ptrdiff_t>(i));
+		m_isSeriesOutdated = true;
 	}
+	ui->action_CompareWith->setEnabled(!m_activities.Empty());
+	ui->action_ClearComparison->setEnabled(m_activities.Size() > 1);
 
-	return result;
-}
-
-std::vector<std::tuple<Trackpoint, std::optional<double>, std::optional<double>>> GetMovingAverageOfVectorOld(std::vector<std::tuple<Trackpoint, std::optional<double>>> const& input, std::size_t windowSize) {
-	std::vector<std::tuple<Trackpoint, std::optional<double>, std::optional<double>>> result;
+	if (newActivityCount > 0 && errors.isEmpty()) {
+		qint64 const derivationDurationMs = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
+		QString const source = (newActivityCount == 1) ? QString("file") : QString("%1 files").arg(newActivityCount);
+		ui->statusbar->showMessage(QString("Parsing %1 points from %2 took %3ms (%4ms in XML).").arg(newPointCount).arg(source).arg(m_lastParseDurationMs + derivationDurationMs).arg(m_lastParseDurationMs));
+	}
 
-	for (std::size_t i = 0; i < input.size(); ++i) {
-		std::size_t lastExistingIndex = i;
-		double sum = 0.0;
-		std::size_t summands = 0;
-		for (std::size_t j = 0; j < windowSize; ++j) {
-			if ((i + j) < input.size()) {
-				lastExistingIndex = (i + j);
-			}
-			auto const& speed = std::get<1>(input.at(lastExistingIndex));
-			if (speed.has_value()) {
-				sum += speed.value();
-				++summands;
+	if (m_chartView == nullptr && !m_activities.Empty()) {
+		CreateChart();
+		m_isSeriesOutdated = true;
+	}
+	if (m_chartView != nullptr) {
+		// The series of removed activities point into their columns, so they have to be gone before anything else happens
+		bool const resetZoom = m_isSeriesOutdated;
+		if (m_isSeriesOutdated) {
+			RebuildSeries();
+			m_isSeriesOutdated = false;
+			for (auto& result : results) {
+				result.recomputed.set();
 			}
 		}
-
-		if (summands > 0) {
-			result.push_back(std::make_tuple(std::get<0>(input.at(i)), std::get<1>(input.at(i)), sum / windowSize));
+		bool const hasRecomputed = std::any_of(results.cbegin(), results.cend(), [](auto const& result) { return result.recomputed.any(); });
+		// If nothing had to be recomputed, only the visibility changed
+		if (hasRecomputed) {
+			UpdateSeries(results, resetZoom);
 		}
 		else {
-			result.push_back(std::make_tuple(std::get<0>(input.at(i)), std::get<1>(input.at(i)), std::nullopt));
+			ApplySeriesVisibility();
 		}
 	}
 
-	return result;
+	if (!errors.isEmpty()) {
+		QMessageBox::critical(this, "Error", QString("Failed to process:\n%1").arg(errors.join('\n')));
+	}
 }
 
-template<typename Callable, typename... OPT_DBL>
-auto GetMovingAverageOfVector(std::vector<std::tuple<Trackpoint, OPT_DBL...>> const& input, Callable valueExtractor, DataOptions::Data const& data) {
-	std::vector<std::tuple<Trackpoint, OPT_DBL..., std::optional<double>>> result;
-
-	for (std::size_t i = 0; i < input.size(); ++i) {
-		std::size_t lastExistingIndex = i;
-		double sum = 0.0;
-		std::size_t summands = 0;
-		for (std::size_t j = 0; j < data.windowSize; ++j) {
-			if ((i + j) < input.size()) {
-				lastExistingIndex = (i + j);
-			}
-			auto const val = valueExtractor(input.at(lastExistingIndex));
-			if (val.has_value() && val.value() >= data.cutoffMin && val.value() <= data.cutoffMax) {
-				sum += val.value();
-				++summands;
-			}
-		}
+void MainWindow::CreateChart() {
+	QChart* chart = new QChart();
 
-		if (summands > 0) {
-			result.push_back(std::tuple_cat(input.at(i), std::make_tuple(std::optional<double>(sum / summands))));
-		}
-		else {
-			result.push_back(std::tuple_cat(input.at(i), std::make_tuple(std::nullopt)));
-		}
-	}
+	m_axisTime = new QDateTimeAxis(chart);
+	m_axisTime->setFormat("dd.MM.yyyy'\r\n'hh:mm:ss");
+	chart->addAxis(m_axisTime, Qt::AlignBottom);
 
-	return result;
-}
+	m_axisAligned = new QValueAxis(chart);
+	chart->addAxis(m_axisAligned, Qt::AlignBottom);
 
-template<typename Callable, typename... OPT_DBL>
-auto Transform(std::vector<std::tuple<Trackpoint, OPT_DBL...>> const& input, Callable valueExtractor) {
-	std::vector<std::tuple<Trackpoint, OPT_DBL..., std::optional<double>>> result;
+	m_axisAvgSpeedInMs = new QValueAxis(chart);
+	m_axisAvgSpeedInMs->setLabelFormat("%.2f");
+	m_axisAvgSpeedInMs->setTitleText("Avg. Speed in m/s");
+	chart->addAxis(m_axisAvgSpeedInMs, Qt::AlignLeft);
 
-	for (auto const& i : input) {
-		auto val = valueExtractor(i);
-		result.push_back(std::tuple_cat(i, std::make_tuple(val)));
-	}
+	m_axisAvgSpeedInKmh = new QValueAxis(chart);
+	m_axisAvgSpeedInKmh->setLabelFormat("%.2f");
+	m_axisAvgSpeedInKmh->setTitleText("Avg. Speed in km/h");
+	chart->addAxis(m_axisAvgSpeedInKmh, Qt::AlignLeft);
 
-	return result;
+	m_axisAvgHeartBeat = new QValueAxis(chart);
+	m_axisAvgHeartBeat->setLabelFormat("%i");
+	m_axisAvgHeartBeat->setTitleText("Avg. Heartrate in BPM");
+	chart->addAxis(m_axisAvgHeartBeat, Qt::AlignRight);
+
+	m_axisAvgPace = new QValueAxis(chart);
+	m_axisAvgPace->setLabelFormat("%.2f");
+	m_axisAvgPace->setTitleText("Avg. Pace in min/km");
+	chart->addAxis(m_axisAvgPace, Qt::AlignRight);
+
+	ApplyAlignmentAxis();
+
+	m_chartView = new ChartView(chart, nullptr);
+	if (!QObject::connect(m_chartView, SIGNAL(newValuesUnderMouse()), this, SLOT(OnNewValuesUnderMouse()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up signal connection to ChartView!");
+		throw;
+	}
+	if (!QObject::connect(m_axisTime, SIGNAL(rangeChanged(QDateTime,QDateTime)), m_chartView, SLOT(redecimate()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up signal connection for re-decimating the chart!");
+		throw;
+	}
+	if (!QObject::connect(m_axisAligned, SIGNAL(rangeChanged(qreal,qreal)), m_chartView, SLOT(redecimate()))) {
+		QMessageBox::critical(this, "Internal Error", "Failed to set up signal connection for re-decimating the aligned chart!");
+		throw;
+	}
+	m_chartView->setRenderHint(QPainter::Antialiasing);
+	m_chartView->setTimingOverlayVisible(ui->action_ShowTimings->isChecked());
+	ui->verticalLayout->addWidget(m_chartView);
 }
 
-void MainWindow::UpdateChart() {
-	if (m_selectedFile.empty())
-		return;
+void MainWindow::ApplyAlignmentAxis() {
+	switch (GetAlignmentMode()) {
+		case AlignmentMode::ElapsedTime:
+			m_axisAligned->setLabelFormat("%.1f");
+			m_axisAligned->setTitleText("Elapsed Time in min");
+			break;
+		case AlignmentMode::Distance:
+			m_axisAligned->setLabelFormat("%.2f");
+			m_axisAligned->setTitleText("Distance in km");
+			break;
+		case AlignmentMode::ClockTime:
+		default:
+			break;
+	}
+	// Only one x axis is shown, the other one has no series attached
+	bool const isClockTime = GetAlignmentMode() == AlignmentMode::ClockTime;
+	m_axisTime->setVisible(isClockTime);
+	m_axisAligned->setVisible(!isClockTime);
+}
 
-	auto const timeStart = std::chrono::steady_clock::now();
-	if (!m_trackpoints.has_value()) {
-		if (!std::filesystem::exists(m_selectedFile)) {
-			if (DO_DEBUG) std::cerr << "Error: Input file " << m_selectedFile << " does not exist!" << std::endl;
-			ui->statusbar->showMessage(QString("Error: Input file '%1' does not exist!").arg(QString::fromStdString(m_selectedFile)));
-			return;
+void MainWindow::RebuildSeries() {
+	QChart* chart = m_chartView->chart();
+	for (auto const& activitySeries : m_activitySeries) {
+		for (QLineSeries* series : { activitySeries.avgSpeedInMs, activitySeries.avgSpeedInKmh, activitySeries.avgHeartBeat, activitySeries.avgPace }) {
+			m_chartView->removeSeriesData(series);
+			chart->removeSeries(series);
+			delete series;
 		}
+	}
+	m_activitySeries.clear();
+
+	// When comparing, every activity has its own color and every value its own line style
+	static std::array<Qt::GlobalColor, 10> constexpr ACTIVITY_COLORS = { Qt::blue, Qt::red, Qt::darkGreen, Qt::magenta, Qt::darkCyan, Qt::darkYellow, Qt::black, Qt::darkRed, Qt::darkBlue, Qt::gray };
+	bool const isComparing = m_activities.Size() > 1;
+	QAbstractAxis* const axisX = (GetAlignmentMode() == AlignmentMode::ClockTime) ? static_cast<QAbstractAxis*>(m_axisTime) : static_cast<QAbstractAxis*>(m_axisAligned);
+	for (std::size_t i = 0; i < m_activities.Size(); ++i) {
+		QString const prefix = isComparing ? QString("%1: ").arg(QString::fromStdString(m_activities.Get(i).file.stem().string())) : QString();
+		auto const createSeries = [&](QValueAxis* axisY, QString const& name, Qt::PenStyle penStyle) {
+			QLineSeries* series = new QLineSeries();
+			chart->addSeries(series);
+			series->attachAxis(axisX);
+			series->attachAxis(axisY);
+			series->setName(prefix + name);
+			if (isComparing) {
+				QPen pen = series->pen();
+				pen.setColor(ACTIVITY_COLORS[i % ACTIVITY_COLORS.size()]);
+				pen.setStyle(penStyle);
+				series->setPen(pen);
+			}
+			return series;
+		};
+
+		ActivitySeries activitySeries;
+		activitySeries.avgSpeedInMs = createSeries(m_axisAvgSpeedInMs, "Avg. Speed in m/s", Qt::SolidLine);
+		activitySeries.avgSpeedInKmh = createSeries(m_axisAvgSpeedInKmh, "Avg. Speed in km/h", Qt::DashDotLine);
+		activitySeries.avgHeartBeat = createSeries(m_axisAvgHeartBeat, "Avg. Heartrate in BPM", Qt::DotLine);
+		activitySeries.avgPace = createSeries(m_axisAvgPace, "Avg. Pace in min/km", Qt::DashLine);
+		m_activitySeries.push_back(activitySeries);
+	}
+	ApplySeriesVisibility();
+}
 
-		Parser parser(m_selectedFile, DO_DEBUG);
-		m_trackpoints = parser.GetTrackpoints();
-		if (DO_DEBUG) std::cout << "Got " << m_trackpoints.value().size() << " trackpoints from input file." << std::endl;
-		ui->statusbar->showMessage(QString("Got %1 trackpoints from input file.").arg(m_trackpoints.value().size()));
-	}
-
-	auto const timeTps = std::chrono::steady_clock::now();
-
-	auto const data0 = GetSpeedFromTrackpoints(m_trackpoints.value());
-	auto const data1 = GetMovingAverageOfVector(data0, [](decltype(data0)::value_type const& v) { return std::get<1>(v); }, ui->gbox_avgSpeed->getData());
-	auto const data2 = GetMovingAverageOfVector(data1, [](decltype(data1)::value_type const& v) { return std::optional<double>(std::get<0>(v).heartRateBpm); }, ui->gbox_heartRate->getData());
-	auto const data3 = Transform(data2, [&](decltype(data2)::value_type const& v) -> std::optional<double>{
-		auto const& e = std::get<2>(v);
-		if (!e.has_value()) return std::nullopt;
-		if (std::abs(e.value()) <= 0.01) return std::nullopt;
-		double const pace = 1.0 / (METERS_PER_SECOND_TO_KILOMETERS_PER_HOUR(e.value()) / 60.0);
-		return std::optional<double>(pace);
-	});
-	auto const data4 = GetMovingAverageOfVector(data3, [](decltype(data3)::value_type const& v) { return std::get<4>(v); }, ui->gbox_pace->getData());
-	auto const data5 = Transform(data4, [&](decltype(data4)::value_type const& v) -> std::optional<double> {
-		auto const& e = std::get<1>(v);
-		if (!e.has_value()) return std::nullopt;
-		return std::optional<double>(METERS_PER_SECOND_TO_KILOMETERS_PER_HOUR(e.value()));
-		});
-	auto const data6 = GetMovingAverageOfVector(data5, [](decltype(data5)::value_type const& v) { return std::get<6>(v); }, ui->gbox_avgSpeedKmh->getData());
+void MainWindow::UpdateSeries(std::vector<ActivityComparison::UpdateResult> const& results, bool resetZoom) {
+	TRACE_SCOPE("Build chart series");
+	QChart* chart = m_chartView->chart();
+	if (resetZoom) {
+		chart->zoomReset();
+	}
+	// While the user is zoomed in, the axes stay where they are
+	bool const updateRanges = !chart->isZoomed();
+	AlignmentMode const alignment = GetAlignmentMode();
 
-	auto const timeEnd = std::chrono::steady_clock::now();
-	ui->statusbar->showMessage(QString("Parsing %1 points from file took %2ms (%3ms in XML).").arg(m_trackpoints.value().size()).arg(std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count()).arg(std::chrono::duration_cast<std::chrono::milliseconds>(timeTps - timeStart).count()));
-
-	// Chart
-	bool const haveAvgSpeedInMs = ui->gbox_avgSpeed->getData().show;
-	bool const haveAvgSpeedInKmh = ui->gbox_avgSpeedKmh->getData().show;
-	bool const haveAvgHeartRate = ui->gbox_heartRate->getData().show;
-	bool const haveAvgPace = ui->gbox_pace->getData().show;
-
-	QLineSeries* seriesAvgSpeedInMs = new QLineSeries();
-	QLineSeries* seriesAvgSpeedInKmh = new QLineSeries();
-	QLineSeries* seriesAvgPace = new QLineSeries();
-	QLineSeries* seriesAvgHeartBeat = new QLineSeries();
-	for (auto const& [tp, speed, avgSpeed, avgHeartBeat, pace, avgPace, speedInKmh, avgSpeedInKmh] : data6) {
-		qreal const time = tp.dateTime.toMSecsSinceEpoch();
-		if (avgSpeed.has_value()) {
-			seriesAvgSpeedInMs->append(time, avgSpeed.value());
-		}
-		if (avgSpeedInKmh.has_value()) {
-			seriesAvgSpeedInKmh->append(time, avgSpeedInKmh.value());
+	// Set the x range first, so the series are decimated for the right range right away
+	if (updateRanges) {
+		UpdateAlignedRange();
+	}
+
+	// The series only reference the columns, the value axes cover all activities
+	auto const updateSeries = [&](SeriesColumn column, QLineSeries* ActivitySeries::* series, QValueAxis* axis) {
+		bool isRecomputed = false;
+		for (std::size_t i = 0; i < m_activities.Size(); ++i) {
+			if (!results[i].recomputed.test(static_cast<std::size_t>(column))) continue;
+			m_chartView->setSeriesData(m_activitySeries[i].*series, m_activities.Get(i).axes.Get(alignment), m_activities.Get(i).derivedSeries.GetColumn(column));
+			isRecomputed = true;
 		}
-		if (avgPace.has_value()) {
-			seriesAvgPace->append(time, avgPace.value());
+		if (!isRecomputed || !updateRanges) return;
+
+		qreal minValue = std::numeric_limits<qreal>::max();
+		qreal maxValue = std::numeric_limits<qreal>::lowest();
+		for (std::size_t i = 0; i < m_activities.Size(); ++i) {
+			for (double const value : m_activities.Get(i).derivedSeries.GetColumn(column)) {
+				if (std::isnan(value)) continue;
+				minValue = std::min(minValue, value);
+				maxValue = std::max(maxValue, value);
+			}
 		}
-		if (avgHeartBeat.has_value()) {
-			seriesAvgHeartBeat->append(time, avgHeartBeat.value());
+		if (minValue <= maxValue) {
+			axis->setRange(minValue, maxValue);
 		}
+	};
+	updateSeries(SeriesColumn::AvgSpeed, &ActivitySeries::avgSpeedInMs, m_axisAvgSpeedInMs);
+	updateSeries(SeriesColumn::AvgSpeedKmh, &ActivitySeries::avgSpeedInKmh, m_axisAvgSpeedInKmh);
+	updateSeries(SeriesColumn::AvgHeartRate, &ActivitySeries::avgHeartBeat, m_axisAvgHeartBeat);
+	updateSeries(SeriesColumn::AvgPace, &ActivitySeries::avgPace, m_axisAvgPace);
+
+	ApplySeriesVisibility();
+}
+
+void MainWindow::UpdateAlignedRange() {
+	AlignmentMode const alignment = GetAlignmentMode();
+	double minX = std::numeric_limits<double>::max();
+	double maxX = std::numeric_limits<double>::lowest();
+	for (std::size_t i = 0; i < m_activities.Size(); ++i) {
+		auto const& x = m_activities.Get(i).axes.Get(alignment);
+		if (x == nullptr || x->empty()) continue;
+		minX = std::min(minX, x->front());
+		maxX = std::max(maxX, x->back());
+	}
+	if (minX > maxX) return;
+	if (alignment == AlignmentMode::ClockTime) {
+		m_axisTime->setRange(QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(minX)), QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(maxX)));
+	}
+	else {
+		m_axisAligned->setRange(minX, maxX);
+	}
+}
+
+DerivationOptions MainWindow::GetDerivationOptions() const {
+	DerivationOptions options;
+	if (ui->action_SpeedFromPositions->isChecked()) {
+		options.speedSource = SpeedSource::Positions;
+	}
+	else if (ui->action_SpeedFromSmoothedPositions->isChecked()) {
+		options.speedSource = SpeedSource::SmoothedPositions;
 	}
+	options.avgSpeed = ui->gbox_avgSpeed->getData();
+	options.avgSpeedKmh = ui->gbox_avgSpeedKmh->getData();
+	options.heartRate = ui->gbox_heartRate->getData();
+	options.pace = ui->gbox_pace->getData();
+	return options;
+}
 
-	QChart* chart = new QChart();
-	chart->addSeries(seriesAvgSpeedInMs);
-	chart->addSeries(seriesAvgSpeedInKmh);
-	chart->addSeries(seriesAvgHeartBeat);
-	chart->addSeries(seriesAvgPace);
-
-	QDateTimeAxis* valueAxisTime = new QDateTimeAxis(chart);
-	valueAxisTime->setFormat("dd.MM.yyyy'\r\n'hh:mm:ss");
-	chart->addAxis(valueAxisTime, Qt::AlignBottom);
-
-	QValueAxis* valueAxisAvgSpeed = new QValueAxis(chart);
-	valueAxisAvgSpeed->setLabelFormat("%.2f");
-	valueAxisAvgSpeed->setTitleText("Avg. Speed in m/s");
-	chart->addAxis(valueAxisAvgSpeed, Qt::AlignLeft);
-
-	QValueAxis* valueAxisAvgSpeedInKmh = new QValueAxis(chart);
-	valueAxisAvgSpeedInKmh->setLabelFormat("%.2f");
-	valueAxisAvgSpeedInKmh->setTitleText("Avg. Speed in km/h");
-	chart->addAxis(valueAxisAvgSpeedInKmh, Qt::AlignLeft);
-
-	QValueAxis* valueAxisHeartBeat = new QValueAxis(chart);
-	valueAxisHeartBeat->setLabelFormat("%i");
-	valueAxisHeartBeat->setTitleText("Avg. Heartrate in BPM");
-	chart->addAxis(valueAxisHeartBeat, Qt::AlignRight);
-
-	QValueAxis* valueAxisPace = new QValueAxis(chart);
-	valueAxisPace->setLabelFormat("%.2f");
-	valueAxisPace->setTitleText("Avg. Pace in min/km");
-	chart->addAxis(valueAxisPace, Qt::AlignRight);
-
-	seriesAvgSpeedInMs->attachAxis(valueAxisTime);
-	seriesAvgSpeedInMs->attachAxis(valueAxisAvgSpeed);
-	seriesAvgSpeedInMs->setName("Avg. Speed in m/s");
-	seriesAvgSpeedInMs->setVisible(haveAvgSpeedInMs);
-
-	seriesAvgSpeedInKmh->attachAxis(valueAxisTime);
-	seriesAvgSpeedInKmh->attachAxis(valueAxisAvgSpeedInKmh);
-	seriesAvgSpeedInKmh->setName("Avg. Speed in km/h");
-	seriesAvgSpeedInKmh->setVisible(haveAvgSpeedInKmh);
-
-	seriesAvgHeartBeat->attachAxis(valueAxisTime);
-	seriesAvgHeartBeat->attachAxis(valueAxisHeartBeat);
-	seriesAvgHeartBeat->setName("Avg. Heartrate in BPM");
-	seriesAvgHeartBeat->setVisible(haveAvgHeartRate);
-
-	seriesAvgPace->attachAxis(valueAxisTime);
-	seriesAvgPace->attachAxis(valueAxisPace);
-	seriesAvgPace->setName("Avg. Pace in min/km");
-	seriesAvgPace->setVisible(haveAvgPace);
-
-	ChartView* chartView = new ChartView(chart, nullptr);
-	if (!QObject::connect(chartView, SIGNAL(newValuesUnderMouse()), this, SLOT(OnNewValuesUnderMouse()))) {
-		QMessageBox::critical(this, "Internal Error", "Failed to set up signal connection to ChartView!");
-		throw;
+AlignmentMode MainWindow::GetAlignmentMode() const {
+	if (ui->action_AlignByElapsedTime->isChecked()) {
+		return AlignmentMode::ElapsedTime;
+	}
+	if (ui->action_AlignByDistance->isChecked()) {
+		return AlignmentMode::Distance;
+	}
+	return AlignmentMode::ClockTime;
+}
+
+void MainWindow::ApplySeriesVisibility() {
+	bool const showAvgSpeed = ui->gbox_avgSpeed->getData().show;
+	bool const showAvgSpeedKmh = ui->gbox_avgSpeedKmh->getData().show;
+	bool const showHeartRate = ui->gbox_heartRate->getData().show;
+	bool const showPace = ui->gbox_pace->getData().show;
+	for (auto const& activitySeries : m_activitySeries) {
+		activitySeries.avgSpeedInMs->setVisible(showAvgSpeed);
+		activitySeries.avgSpeedInKmh->setVisible(showAvgSpeedKmh);
+		activitySeries.avgHeartBeat->setVisible(showHeartRate);
+		activitySeries.avgPace->setVisible(showPace);
 	}
-	chartView->setRenderHint(QPainter::Antialiasing);
+}
 
-	if (m_lastChartView != nullptr) {
-		ui->verticalLayout->removeWidget(m_lastChartView);
-		delete m_lastChartView;
-		m_lastChartView = nullptr;
+void MainWindow::OnSpeedSourceChanged() {
+	OnDataOptionsChanged(nullptr);
+}
+
+void MainWindow::OnAlignmentChanged() {
+	if (m_chartView == nullptr) return;
+
+	TRACE_SCOPE("Switch alignment");
+	// The x values of every alignment are computed with the series, so switching only swaps arrays and decimates the visible range again
+	AlignmentMode const alignment = GetAlignmentMode();
+	QAbstractAxis* const newAxis = (alignment == AlignmentMode::ClockTime) ? static_cast<QAbstractAxis*>(m_axisTime) : static_cast<QAbstractAxis*>(m_axisAligned);
+	QAbstractAxis* const oldAxis = (newAxis == m_axisTime) ? static_cast<QAbstractAxis*>(m_axisAligned) : static_cast<QAbstractAxis*>(m_axisTime);
+	for (std::size_t i = 0; i < m_activitySeries.size(); ++i) {
+		auto const& activitySeries = m_activitySeries[i];
+		for (QLineSeries* series : { activitySeries.avgSpeedInMs, activitySeries.avgSpeedInKmh, activitySeries.avgHeartBeat, activitySeries.avgPace }) {
+			series->detachAxis(oldAxis);
+			series->attachAxis(newAxis);
+			m_chartView->setSeriesX(series, m_activities.Get(i).axes.Get(alignment));
+		}
 	}
+	ApplyAlignmentAxis();
 
-	m_lastChartView = chartView;
-	ui->verticalLayout->addWidget(chartView);	
+	m_chartView->chart()->zoomReset();
+	UpdateAlignedRange();
+	m_chartView->redecimate();
 }
 
 void MainWindow::OnDataOptionsChanged(DataOptions*) {
@@ -336,8 +616,32 @@ void MainWindow::OnDataOptionsChanged(DataOptions*) {
 }
 
 void MainWindow::OnNewValuesUnderMouse() {
-	if (m_lastChartView != nullptr) {
-		auto const& values = m_lastChartView->getValuesUnderMouse();
-		ui->statusbar->showMessage(QString("Time %1, Avg. Speed %2, Heatrate %3").arg(QDateTime::fromMSecsSinceEpoch(values.at(0)).toString("dd.MM.yyyy hh:mm:ss")).arg(values.at(1), 0, 'f', 2).arg(values.at(3)));
+	if (m_chartView != nullptr) {
+		auto const& values = m_chartView->getValuesUnderMouse();
+		// The position comes from the cursor itself, the values of the series may be missing there
+		qreal const x = m_chartView->getXUnderMouse();
+		QString position;
+		AlignmentMode const alignment = GetAlignmentMode();
+		if (alignment == AlignmentMode::ClockTime || m_activities.Empty()) {
+			position = QString("Time %1").arg(QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(x)).toString("dd.MM.yyyy hh:mm:ss"));
+		}
+		else {
+			// The axes of the first activity map the position to its row and so to the other alignment
+			auto const& axes = m_activities.Get(0).axes;
+			std::size_t const row = axes.FindRow(alignment, x);
+			auto const& elapsedTime = *axes.Get(AlignmentMode::ElapsedTime);
+			auto const& distance = *axes.Get(AlignmentMode::Distance);
+			if (row < elapsedTime.size()) {
+				position = QString("Elapsed %1 min, Distance %2 km").arg(elapsedTime[row], 0, 'f', 1).arg(distance[row], 0, 'f', 2);
+			}
+			else {
+				position = QString("Past the end");
+			}
+		}
+		// The first activity's series come first: m/s, km/h, heart rate and pace, each as x and y
+		auto const format = [&](std::size_t index, int precision) {
+			return (index < values.size() && !std::isnan(values[index])) ? QString::number(values[index], 'f', precision) : QString("-");
+		};
+		ui->statusbar->showMessage(QString("%1, Avg. Speed %2, Heatrate %3").arg(position, format(1, 2), format(5, 0)));
 	}
 }
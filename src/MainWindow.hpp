@@ -1,19 +1,24 @@
 #pragma once
 
 #include <string>
-#include <optional>
 #include <vector>
 
+#include <QDateTimeAxis>
+#include <QLineSeries>
 #include <QMainWindow>
+#include <QProgressBar>
+#include <QValueAxis>
 
+#include "ActivityComparison.hpp"
 #include "DataOptions.hpp"
-#include "Trackpoint.hpp"
+#include "DerivedSeries.hpp"
 
 namespace Ui {
 class MainWindow;
 }
 
 class ChartView;
+class TrackLoader;
 
 class MainWindow : public QMainWindow
 {
@@ -25,17 +30,68 @@ public:
 
 public slots:
     void SelectNewFile();
+    void SelectFromLibrary();
+    void SelectComparedFiles();
+    void ClearComparison();
+    void CancelLoading();
+    void ShowTimings(bool isEnabled);
+    void ExportTrace();
 
     void UpdateChart();
 
+    void OnLoadProgress(quint64 generation, qint64 bytesDone, qint64 bytesTotal);
+    void OnLoadFinished(quint64 generation, qint64 durationMs);
+    void OnLoadFailed(quint64 generation, QString message);
+    void OnLoadCancelled(quint64 generation);
+
     void OnDataOptionsChanged(DataOptions* options);
+    void OnSpeedSourceChanged();
+    void OnAlignmentChanged();
     void OnNewValuesUnderMouse();
 
 private:
+    // The chart series of one activity, owned by the chart of m_chartView
+    struct ActivitySeries {
+        QLineSeries* avgSpeedInMs = nullptr;
+        QLineSeries* avgSpeedInKmh = nullptr;
+        QLineSeries* avgHeartBeat = nullptr;
+        QLineSeries* avgPace = nullptr;
+    };
+
     Ui::MainWindow *ui;
 
+    void LoadFile(QString const& filename);
+    void SetLoading(bool isLoading);
+    DerivationOptions GetDerivationOptions() const;
+    AlignmentMode GetAlignmentMode() const;
+    void ApplySeriesVisibility();
+    void CreateChart();
+    void ApplyAlignmentAxis();
+    void RebuildSeries();
+    void UpdateSeries(std::vector<ActivityComparison::UpdateResult> const& results, bool resetZoom);
+    void UpdateAlignedRange();
+
     std::string m_selectedFile;
-    ChartView* m_lastChartView = nullptr;
-    std::optional<std::vector<Trackpoint>> m_trackpoints = std::nullopt;
+    QString m_libraryDirectory;
+    // Parsing happens in the background, only the results of the latest load are used
+    TrackLoader* m_trackLoader = nullptr;
+    quint64 m_loadGeneration = 0;
+    // Whether the latest load adds files to the comparison instead of replacing all activities
+    bool m_isLoadingComparedFiles = false;
+    qint64 m_lastParseDurationMs = 0;
+    QProgressBar* m_loadProgress = nullptr;
+    // Created once with the first file, afterwards only the data of the series changes.
+    ChartView* m_chartView = nullptr;
+    // One entry per activity of m_activities, rebuilt whenever activities are added or removed
+    std::vector<ActivitySeries> m_activitySeries;
+    bool m_isSeriesOutdated = false;
+    // Owned by the chart of m_chartView. The series are attached to m_axisTime when aligned by clock time, to m_axisAligned otherwise.
+    QDateTimeAxis* m_axisTime = nullptr;
+    QValueAxis* m_axisAligned = nullptr;
+    QValueAxis* m_axisAvgSpeedInMs = nullptr;
+    QValueAxis* m_axisAvgSpeedInKmh = nullptr;
+    QValueAxis* m_axisAvgHeartBeat = nullptr;
+    QValueAxis* m_axisAvgPace = nullptr;
+    ActivityComparison m_activities;
 };
 
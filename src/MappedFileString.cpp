@@ -1,27 +1,33 @@
 #include "MappedFileString.hpp"
 
-#include <fstream>
-#include <iostream>
+#include <system_error>
 
 #ifdef _MSC_VER
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <Memoryapi.h>
+#else
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 MappedFileString::MappedFileString(std::string const& fqfn) {
 #ifdef _MSC_VER
 	m_fileHandle = CreateFileA(fqfn.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 	if (m_fileHandle == INVALID_HANDLE_VALUE) {
-		std::cerr << "Internal Error: Failed to open file '" << fqfn << "', last error = " << GetLastError() << std::endl;
-		throw;
+		DWORD const lastError = GetLastError();
+		throw std::system_error(static_cast<int>(lastError), std::system_category(), "Failed to open file '" + fqfn + "'");
 	}
 	LARGE_INTEGER m_fileSize;
 	m_fileSize.QuadPart = 0;
 	if (!GetFileSizeEx(m_fileHandle, &m_fileSize)) {
-		std::cerr << "Internal Error: Failed to get file size of '" << fqfn << "', last error = " << GetLastError() << std::endl;
+		DWORD const lastError = GetLastError();
 		CloseHandle(m_fileHandle);
-		throw;
+		throw std::system_error(static_cast<int>(lastError), std::system_category(), "Failed to get file size of '" + fqfn + "'");
 	}
 
 	if (m_fileSize.QuadPart == 0) {
@@ -34,24 +40,66 @@ MappedFileString::MappedFileString(std::string const& fqfn) {
 	} else {
 		m_mapping = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
 		if (m_mapping == NULL) {
-			std::cerr << "Internal Error: Failed to create file mapping to '" << fqfn << "', last error = " << GetLastError() << std::endl;
+			DWORD const lastError = GetLastError();
 			CloseHandle(m_fileHandle);
-			throw;
+			throw std::system_error(static_cast<int>(lastError), std::system_category(), "Failed to create file mapping to '" + fqfn + "'");
 		}
 
 		m_baseAddress = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
 		if (m_baseAddress == NULL) {
-			std::cerr << "Internal Error: Failed to map file '" << fqfn << "' into view, last error = " << GetLastError() << std::endl;
+			DWORD const lastError = GetLastError();
 			CloseHandle(m_mapping);
 			CloseHandle(m_fileHandle);
-			throw;
+			throw std::system_error(static_cast<int>(lastError), std::system_category(), "Failed to map file '" + fqfn + "' into view");
 		}
 		m_view = std::string_view(static_cast<char const*>(m_baseAddress), m_fileSize.QuadPart);
 	}
 #else
-	std::ifstream file(fqfn);
-	m_content = std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-	m_view = std::string_view(m_content);
+	m_fileDescriptor = ::open(fqfn.c_str(), O_RDONLY | O_CLOEXEC);
+	if (m_fileDescriptor < 0) {
+		int const lastError = errno;
+		throw std::system_error(lastError, std::generic_category(), "Failed to open file '" + fqfn + "'");
+	}
+	struct stat fileStat;
+	if (::fstat(m_fileDescriptor, &fileStat) != 0) {
+		int const lastError = errno;
+		::close(m_fileDescriptor);
+		throw std::system_error(lastError, std::generic_category(), "Failed to get file size of '" + fqfn + "'");
+	}
+
+	if (S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+		m_mappingSize = static_cast<std::size_t>(fileStat.st_size);
+		void* const address = ::mmap(nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+		if (address == MAP_FAILED) {
+			int const lastError = errno;
+			::close(m_fileDescriptor);
+			throw std::system_error(lastError, std::generic_category(), "Failed to map file '" + fqfn + "' into view");
+		}
+		m_baseAddress = address;
+		// The parsers walk the file front to back exactly once
+		::madvise(m_baseAddress, m_mappingSize, MADV_SEQUENTIAL);
+		m_view = std::string_view(static_cast<char const*>(m_baseAddress), m_mappingSize);
+	} else if (S_ISREG(fileStat.st_mode)) {
+		// Mapping an empty file will fail, so we should not try
+		m_view = std::string_view();
+	} else {
+		// Pipes, FIFOs and character devices can not be mapped, read them in chunks instead
+		char buffer[64 * 1024];
+		while (true) {
+			auto const bytesRead = ::read(m_fileDescriptor, buffer, sizeof(buffer));
+			if (bytesRead < 0 && errno == EINTR) {
+				continue;
+			} else if (bytesRead < 0) {
+				int const lastError = errno;
+				::close(m_fileDescriptor);
+				throw std::system_error(lastError, std::generic_category(), "Failed to read from file '" + fqfn + "'");
+			} else if (bytesRead == 0) {
+				break;
+			}
+			m_content.append(buffer, static_cast<std::size_t>(bytesRead));
+		}
+		m_view = std::string_view(m_content);
+	}
 #endif
 }
 MappedFileString::~MappedFileString() {
@@ -59,5 +107,8 @@ MappedFileString::~MappedFileString() {
 	if (m_baseAddress != NULL) UnmapViewOfFile(m_baseAddress);
 	if (m_mapping != NULL) CloseHandle(m_mapping);
 	if (m_fileHandle != INVALID_HANDLE_VALUE) CloseHandle(m_fileHandle);
+#else
+	if (m_baseAddress != nullptr) ::munmap(m_baseAddress, m_mappingSize);
+	if (m_fileDescriptor >= 0) ::close(m_fileDescriptor);
 #endif
 }
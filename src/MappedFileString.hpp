@@ -1,28 +1,34 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
+// Read-only view on the contents of a file. Regular files are memory-mapped, so GetView() does not copy anything.
+// Files that can not be mapped (e.g. pipes or other special files) are read into an internal buffer instead.
+// Throws std::system_error if the file can not be opened, mapped or read.
 class MappedFileString {
 public:
 	MappedFileString(std::string const& fqfn);
 	~MappedFileString();
 
+	MappedFileString(MappedFileString const&) = delete;
+	MappedFileString& operator=(MappedFileString const&) = delete;
+
 	inline std::string_view const& GetView() const {
 		return m_view;
 	}
-	inline std::string GetString() const {
-#ifdef _MSC_VER
-		return std::string(m_view);
-#else
-		return m_content;
-#endif
+	inline bool IsMapped() const {
+		return m_baseAddress != nullptr;
 	}
 private:
+#ifdef _MSC_VER
 	void* m_fileHandle = nullptr;
 	void* m_mapping = nullptr;
+#else
+	int m_fileDescriptor = -1;
+	std::size_t m_mappingSize = 0;
+#endif
 	void* m_baseAddress = nullptr;
-#ifndef _MSC_VER
 	std::string m_content;
-#endif
 	std::string_view m_view;
 };
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// Thrown by the Parser when a file can not be read or does not match the structure we expect.
+// The message is complete, i.e. it already contains the position in the file where available.
+class ParseError : public std::runtime_error {
+public:
+	explicit ParseError(std::string const& message) : std::runtime_error(message) {}
+};
+
+// Thrown by the Parser when its progress callback asked it to stop.
+class ParseCancelled : public std::runtime_error {
+public:
+	ParseCancelled() : std::runtime_error("Parsing was cancelled.") {}
+};
@@ -1,179 +1,662 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <QAnyStringView>
+#include <QDateTime>
 #include <QDomDocument>
 #include <QtGlobal>
 
+#include "FastDecode.hpp"
 #include "MappedFileString.hpp"
+#include "ParseError.hpp"
+#include "Trace.hpp"
+#include "Track.hpp"
 #include "Trackpoint.hpp"
+#include "XmlPullReader.hpp"
 
+enum class ParserBackend {
+	// Pull tokenizer over the mapped file, emits trackpoints while reading. Memory besides the result is bounded by one trackpoint.
+	Streaming,
+	// Builds a full QDomDocument first. Kept for comparison, needs several times the file size in memory.
+	Dom
+};
+
+// Called with the number of bytes of the file consumed so far and the file size. Large files report from one of the worker threads, see parseTrackpointsParallel().
+// Returning false cancels parsing, the Parser throws ParseCancelled then.
+using ParseProgressCallback = std::function<bool(std::size_t bytesDone, std::size_t bytesTotal)>;
+
+// Parses all activities of a file with all their laps into a single Track. Throws ParseError if the file can not be read or is not a TCX file.
+// Values that are missing or malformed only make that value of the trackpoint invalid, trackpoints without a (valid) time are dropped.
+// Parser instances share no state, so any number of files can be parsed concurrently on different threads.
 class Parser {
 public:
 
-	Parser(std::filesystem::path const& inputFile, bool doDebugOutput) : m_inputFile(inputFile) {
-		MappedFileString mappedInputFile(inputFile.string());
+	// Files of at least this size are split up and parsed on several threads by the streaming backend.
+	static constexpr std::size_t PARALLEL_PARSING_MIN_FILE_SIZE = 50 * 1024 * 1024;
+	// Tracks (i.e. laps) are only split into parts of at least this size, smaller ones are not worth starting a thread for.
+	static constexpr std::size_t PARALLEL_PARSING_MIN_PART_SIZE = 4 * 1024 * 1024;
+
+	// Trackpoints between two calls of the progress callback.
+	static constexpr std::size_t PROGRESS_INTERVAL = 1024;
+
+	// A threadCount of 0 uses one thread per hardware thread. The DOM backend only reports progress when it is done.
+	Parser(std::filesystem::path const& inputFile, bool doDebugOutput, ParserBackend backend = ParserBackend::Streaming, unsigned int threadCount = 0, ParseProgressCallback const& progressCallback = ParseProgressCallback()) : m_inputFile(inputFile) {
+		TRACE_SCOPE("Parse file");
+		std::optional<MappedFileString> mappedInputFile;
+		try {
+			mappedInputFile.emplace(inputFile.string());
+		}
+		catch (std::system_error const& e) {
+			throw ParseError(std::string("Error: ") + e.what());
+		}
+		if (threadCount == 0) {
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+		Parse(mappedInputFile.value(), doDebugOutput, backend, threadCount, progressCallback);
+		if (progressCallback) {
+			progressCallback(mappedInputFile.value().GetView().size(), mappedInputFile.value().GetView().size());
+		}
+	}
+	virtual ~Parser() {
+		//
+	}
+
+	Track const& GetTrack() const {
+		return m_track;
+	}
+
+	// Moves the parsed track out of the parser, leaving it empty.
+	Track TakeTrack() {
+		return std::move(m_track);
+	}
+
+private:
+	std::filesystem::path const m_inputFile;
+	Track m_track;
+
+	void Parse(MappedFileString const& mappedInputFile, bool doDebugOutput, ParserBackend backend, unsigned int threadCount, ParseProgressCallback const& progressCallback) {
+		if (backend == ParserBackend::Streaming) {
+			std::size_t const totalBytes = mappedInputFile.GetView().size();
+			auto const progress = [&](std::size_t bytesDone) {
+				return !progressCallback || progressCallback(bytesDone, totalBytes);
+			};
+			ParseActivitiesStreaming(mappedInputFile.GetView(), doDebugOutput, threadCount, m_track, progress);
+			return;
+		}
+
 		QDomDocument doc;
 #if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
 		QAnyStringView contentView(mappedInputFile.GetView());
 		auto const parseResult = doc.setContent(contentView, QDomDocument::ParseOption::UseNamespaceProcessing);
 #else
-		QString const content = QString::fromStdString(mappedInputFile.GetString());
+		QString const content = QString::fromUtf8(mappedInputFile.GetView().data(), static_cast<int>(mappedInputFile.GetView().size()));
 		auto const parseResult = doc.setContent(content, true);
 #endif
 		if (!parseResult) {
 #if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
-			std::cerr << "Encountered an error in XML parsing at line " << parseResult.errorLine << " and column " << parseResult.errorColumn << ": " << parseResult.errorMessage.toStdString() << std::endl;
+			throw ParseError("Encountered an error in XML parsing at line " + std::to_string(parseResult.errorLine) + " and column " + std::to_string(parseResult.errorColumn) + ": " + parseResult.errorMessage.toStdString());
 #else
-			std::cerr << "Encountered an error in XML parsing!" << std::endl;
+			throw ParseError("Encountered an error in XML parsing!");
 #endif
-			throw;
 		}
 
-		m_trackpoints = ParseRunningTrackpoints(doc, doDebugOutput);
-
+		m_track = ParseActivities(doc, doDebugOutput);
 	}
-	virtual ~Parser() {
-		//
+
+	// Compares without a namespace prefix and case-insensitively, like the streaming backend does.
+	static inline bool hasName(QDomElement const& element, QString const& name) {
+		QString const localName = element.localName().isEmpty() ? element.tagName().section(':', -1) : element.localName();
+		return localName.compare(name, Qt::CaseInsensitive) == 0;
 	}
 
-	std::vector<Trackpoint> const& GetTrackpoints() const {
-		return m_trackpoints;
+	template<typename Function>
+	static inline void forEachChildElement(QDomElement const& element, QString const& name, Function&& function) {
+		for (auto child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+			if (hasName(child, name)) {
+				function(child);
+			}
+		}
 	}
 
-private:
-	std::filesystem::path const m_inputFile;
-	std::vector<Trackpoint> m_trackpoints;
+	static inline void warnAboutValue(bool doDebugOutput, QDomElement const& element) {
+		if (doDebugOutput) std::cerr << "Warning: Ignoring malformed value '" << element.text().toStdString() << "' of " << element.tagName().toStdString() << ". Line: " << element.lineNumber() << ", Column: " << element.columnNumber() << std::endl;
+	}
 
-	template<typename T>
-	inline QDomNode getOnlyChild(T const& element, QString const& nodeName) const {
-		auto const nodes = element.childNodes();
-		if (nodes.size() != 1) {
-			std::cerr << "Assumption Error: Node was expected to have exactly one child, but it did not. It has " << nodes.size() << " children. Line: " << element.lineNumber() << ", Column: " << element.columnNumber() << std::endl;
-			for (int i = 0; i < nodes.size(); ++i) {
-				std::cerr << "Child has name '" << nodes.at(i).nodeName().toStdString() << "'" << std::endl;
+	inline void parseTrackpoint(QDomElement const& trackpointElement, bool doDebugOutput, Trackpoint& tp, bool& hasTime) const {
+		for (auto child = trackpointElement.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+			bool isValid = true;
+			if (hasName(child, "Time")) {
+				QDateTime const dateTime = QDateTime::fromString(child.text().trimmed(), Qt::ISODateWithMs);
+				hasTime = dateTime.isValid();
+				isValid = hasTime;
+				tp.timeMs = dateTime.toMSecsSinceEpoch();
+			}
+			else if (hasName(child, "Position")) {
+				double latitudeDegrees = Trackpoint::INVALID_VALUE;
+				double longitudeDegrees = Trackpoint::INVALID_VALUE;
+				forEachChildElement(child, "LatitudeDegrees", [&](QDomElement const& e) { latitudeDegrees = e.text().trimmed().toDouble(&isValid); });
+				forEachChildElement(child, "LongitudeDegrees", [&](QDomElement const& e) { bool ok = false; longitudeDegrees = e.text().trimmed().toDouble(&ok); isValid = isValid && ok; });
+				if (isValid) {
+					tp.latitudeDegrees = latitudeDegrees;
+					tp.longitudeDegrees = longitudeDegrees;
+				}
+			}
+			else if (hasName(child, "AltitudeMeters")) {
+				double const value = child.text().trimmed().toDouble(&isValid);
+				if (isValid) tp.altitudeMeters = value;
+			}
+			else if (hasName(child, "DistanceMeters")) {
+				double const value = child.text().trimmed().toDouble(&isValid);
+				if (isValid) tp.distanceMeters = value;
+			}
+			else if (hasName(child, "HeartRateBpm")) {
+				int const value = child.firstChildElement().text().trimmed().toInt(&isValid);
+				if (isValid) tp.heartRateBpm = value;
 			}
-			throw;
+			else if (hasName(child, "Cadence")) {
+				int const value = child.text().trimmed().toInt(&isValid);
+				if (isValid) tp.cadenceRpm = value;
+			}
+			else if (hasName(child, "Extensions")) {
+				forEachChildElement(child, "TPX", [&](QDomElement const& tpx) {
+					forEachChildElement(tpx, "Watts", [&](QDomElement const& e) {
+						bool ok = false;
+						int const value = e.text().trimmed().toInt(&ok);
+						if (ok) tp.powerWatts = value; else warnAboutValue(doDebugOutput, e);
+					});
+					forEachChildElement(tpx, "RunCadence", [&](QDomElement const& e) {
+						bool ok = false;
+						int const value = e.text().trimmed().toInt(&ok);
+						if (ok && !tp.HasCadence()) tp.cadenceRpm = value; else if (!ok) warnAboutValue(doDebugOutput, e);
+					});
+				});
+			}
+			if (!isValid) {
+				warnAboutValue(doDebugOutput, child);
+			}
+		}
+	}
+
+	Track ParseActivities(QDomDocument const& doc, bool doDebugOutput) const {
+		Track result;
+
+		auto const trainingCenterDatabase = doc.documentElement();
+		if (trainingCenterDatabase.isNull() || !hasName(trainingCenterDatabase, "TrainingCenterDatabase")) {
+			throw ParseError("Assumption Error: Expected the document to be a TrainingCenterDatabase, but it is not.");
 		}
-		auto const node = nodes.at(0);
-		if (node.nodeName().compare(nodeName, Qt::CaseInsensitive) != 0) {
-			std::cerr << "Assumption Error: Node was expected to have exactly one child of type '" << nodeName.toStdString() << "', but it did not. Actual type: '" << node.nodeName().toStdString() << "'. Line: " << element.lineNumber() << ", Column: " << element.columnNumber() << std::endl;
-			throw;
+		QDomElement activities;
+		forEachChildElement(trainingCenterDatabase, "Activities", [&](QDomElement const& element) {
+			if (activities.isNull()) activities = element;
+		});
+		if (activities.isNull()) {
+			throw ParseError("Assumption Error: Node was expected to have a child of type 'Activities', but it did not. Line: " + std::to_string(trainingCenterDatabase.lineNumber()) + ", Column: " + std::to_string(trainingCenterDatabase.columnNumber()));
 		}
-		return node;
+
+		std::size_t pointIndex = 0;
+		forEachChildElement(activities, "Activity", [&](QDomElement const& activity) {
+			if (!activity.hasAttribute("Sport")) {
+				if (doDebugOutput) std::cerr << "Warning: Activity in line " << activity.lineNumber() << " has no Sport, assuming 'Other'." << std::endl;
+			}
+			result.BeginActivity(GetSportByName(activity.attribute("Sport", "Other").toStdString()));
+
+			// Distances start over with every activity, but have to be monotonic within one
+			double lastDistanceInMeters = 0.0;
+			bool isFirstLap = true;
+			forEachChildElement(activity, "Lap", [&](QDomElement const& lap) {
+				if (!isFirstLap) result.BeginLap();
+				isFirstLap = false;
+				forEachChildElement(lap, "Track", [&](QDomElement const& track) {
+					forEachChildElement(track, "Trackpoint", [&](QDomElement const& trackpoint) {
+						Trackpoint tp;
+						bool hasTime = false;
+						parseTrackpoint(trackpoint, doDebugOutput, tp, hasTime);
+						if (!hasTime) {
+							if (doDebugOutput) std::cerr << "Warning: Ignoring trackpoint #" << pointIndex << " without time!" << std::endl;
+							return;
+						}
+
+						if (tp.HasDistance()) {
+							if (tp.distanceMeters < lastDistanceInMeters) {
+								if (doDebugOutput) std::cerr << "Warning: Fixing distance on point #" << pointIndex << "!" << std::endl;
+								tp.distanceMeters = lastDistanceInMeters;
+							}
+							lastDistanceInMeters = tp.distanceMeters;
+						}
+						++pointIndex;
+						result.Append(tp);
+					});
+				});
+			});
+		});
+		if (result.GetActivityStarts().empty()) {
+			throw ParseError("Assumption Error: Node was expected to have a child of type 'Activity', but it did not. Line: " + std::to_string(activities.lineNumber()) + ", Column: " + std::to_string(activities.columnNumber()));
+		}
+
+		return result;
 	}
 
-	template<typename T>
-	inline QDomNode getChildAtIndex(T const& element, int index, QString const& nodeName) const {
-		auto const nodes = element.childNodes();
-		if (nodes.size() <= index) {
-			std::cerr << "Assumption Error: Node was expected to have enough children, but it did not. Line: " << element.lineNumber() << ", Column: " << element.columnNumber() << std::endl;
-			throw;
+	[[noreturn]] inline void reportStreamingError(XmlPullReader const& reader, std::string const& message) const {
+		std::string fullMessage = message + " Line: " + std::to_string(reader.GetLineNumber()) + ", Column: " + std::to_string(reader.GetColumnNumber());
+		if (!reader.GetErrorMessage().empty()) {
+			fullMessage += "\nXML Error: " + std::string(reader.GetErrorMessage());
 		}
-		auto const node = nodes.at(index);
-		if (node.nodeName().compare(nodeName, Qt::CaseInsensitive) != 0) {
-			std::cerr << "Assumption Error: Node was expected to have child of type '" << nodeName.toStdString() << "', but it did not. Line: " << element.lineNumber() << ", Column: " << element.columnNumber() << std::endl;
-			throw;
+		throw ParseError(fullMessage);
+	}
+
+	inline void expectStartElement(XmlPullReader& reader, std::string_view nodeName) const {
+		if (reader.ReadNext() != XmlPullReader::Token::StartElement || !XmlPullReader::NameEquals(reader.GetName(), nodeName)) {
+			reportStreamingError(reader, "Assumption Error: Expected element of type '" + std::string(nodeName) + "', but found '" + std::string(reader.GetQualifiedName()) + "'.");
 		}
-		return node;
 	}
 
-	template<typename T>
-	inline QDomNode getChildByType(T const& element, QString const& nodeType) const {
-		auto const nodes = element.childNodes();
-		for (int index = 0; index < nodes.size(); ++index) {
-			auto const node = nodes.at(index);
-			if (node.nodeName().compare(nodeType, Qt::CaseInsensitive) == 0) {
-				return node;
+	// Advances to the next child element of the current element with the given type, skipping all others.
+	// Returns false if the end of the current element was reached instead.
+	inline bool findChildByType(XmlPullReader& reader, std::string_view nodeType) const {
+		while (true) {
+			auto const token = reader.ReadNext();
+			if (token == XmlPullReader::Token::StartElement) {
+				if (XmlPullReader::NameEquals(reader.GetName(), nodeType)) {
+					return true;
+				}
+				else if (!reader.SkipCurrentElement()) {
+					reportStreamingError(reader, "Error: Failed to skip element.");
+				}
+			}
+			else if (token == XmlPullReader::Token::EndElement) {
+				return false;
+			}
+			else if (token != XmlPullReader::Token::Text) {
+				reportStreamingError(reader, "Error: Unexpected end of document while looking for '" + std::string(nodeType) + "'.");
 			}
 		}
-		
-		std::cerr << "Assumption Error: Node was expected to have a child of type '" << nodeType.toStdString() << "', but it did not. Line: " << element.lineNumber() << ", Column: " << element.columnNumber() << std::endl;
-		for (int index = 0; index < nodes.size(); ++index) {
-			std::cerr << "Child #" << index << "has type '" << nodes.at(index).nodeName().toStdString() << "'" << std::endl;
+	}
+
+	inline std::string_view readElementText(XmlPullReader& reader) const {
+		auto const text = reader.ReadElementText();
+		if (!text.has_value()) {
+			reportStreamingError(reader, "Assumption Error: Expected element to only contain text.");
+		}
+		return text.value();
+	}
+
+	inline void warnAboutValue(XmlPullReader const& reader, bool doDebugOutput, std::string_view text) const {
+		if (doDebugOutput) std::cerr << "Warning: Ignoring malformed value '" << text << "' of " << reader.GetQualifiedName() << ". Line: " << reader.GetLineNumber() << ", Column: " << reader.GetColumnNumber() << std::endl;
+	}
+
+	// Has to be called on a StartElement. A malformed value leaves value as it is, i.e. invalid, and returns false, only broken XML throws.
+	inline bool decodeDouble(XmlPullReader& reader, bool doDebugOutput, double& value) const {
+		auto const text = readElementText(reader);
+		double decoded = 0.0;
+		if (!DecodeDouble(text, decoded)) {
+			warnAboutValue(reader, doDebugOutput, text);
+			return false;
 		}
-		throw;
+		value = decoded;
+		return true;
 	}
 
-	inline QDomElement ensureIsElement(QDomNode const& node) const {
-		if (!node.isElement()) {
-			std::cerr << "Assumption Error: Node was expected to be an element, but it was not. Line: " << node.lineNumber() << ", Column: " << node.columnNumber() << std::endl;
-			throw;
+	template<typename Integer>
+	inline bool decodeInteger(XmlPullReader& reader, bool doDebugOutput, Integer& value) const {
+		auto const text = readElementText(reader);
+		int decoded = 0;
+		if (!DecodeInteger(text, decoded)) {
+			warnAboutValue(reader, doDebugOutput, text);
+			return false;
 		}
-		return node.toElement();
+		value = static_cast<Integer>(decoded);
+		return true;
 	}
 
-	std::vector<Trackpoint> ParseRunningTrackpoints(QDomDocument const& doc, bool doDebugOutput) const {
-		std::vector<Trackpoint> result;
-		
-		auto const trainingCenterDatabase = ensureIsElement(getChildAtIndex(doc, 1, "TrainingCenterDatabase"));
-		auto const activities = ensureIsElement(getOnlyChild(trainingCenterDatabase, "Activities"));
-		auto const activity = ensureIsElement(getOnlyChild(activities, "Activity"));
-		if (!activity.hasAttribute("Sport")) {
-			std::cerr << "Error: Expected Activity to have a 'Sport' attribute, but it did not!" << std::endl;
-			throw;
+	// Calls function with the name of every child element of the current element. It has to read the child up to and including its EndElement, or return false to have it skipped.
+	// Leaves the reader on the EndElement of the current element.
+	template<typename Function>
+	inline void readChildElements(XmlPullReader& reader, std::string_view elementName, Function&& function) const {
+		using Token = XmlPullReader::Token;
+		while (reader.ReadNext() == Token::StartElement) {
+			if (!function(reader.GetName()) && !reader.SkipCurrentElement()) {
+				reportStreamingError(reader, "Error: Failed to skip element.");
+			}
 		}
-		else if (activity.attribute("Sport").compare("Running") != 0) {
-			std::cerr << "Error: Expected Activity.Sport to be 'Running', but it is '" << activity.attribute("Sport").toStdString() << "'!" << std::endl;
-			throw;
+		if (reader.GetToken() != Token::EndElement) {
+			reportStreamingError(reader, "Error: Unexpected content in " + std::string(elementName) + ".");
 		}
+	}
 
-		auto const lap = ensureIsElement(getChildByType(activity, "Lap"));
-		auto const track = ensureIsElement(getChildByType(lap, "Track"));
-		
-		auto const trackpointNodes = track.childNodes();
-		double lastDistanceInMeters = 0.0;
-		for (int i = 0; i < trackpointNodes.size(); ++i) {
-			auto const trackpointNode = ensureIsElement(trackpointNodes.at(i));
+	// Has to be called on the StartElement of a Trackpoint, reads it up to and including its EndElement. Returns false if it has no valid time.
+	inline bool readTrackpoint(XmlPullReader& reader, bool doDebugOutput, Trackpoint& tp) const {
+		bool hasTime = false;
+		readChildElements(reader, "Trackpoint", [&](std::string_view name) {
+			if (XmlPullReader::NameEquals(name, "Time")) {
+				auto const text = readElementText(reader);
+				auto const epochMs = DecodeIsoTimestamp(text);
+				if (epochMs.has_value()) {
+					tp.timeMs = epochMs.value();
+					hasTime = true;
+				} else {
+					// Slow path for timestamps the fixed-format decoder does not handle, e.g. ones in local time
+					QDateTime const dateTime = QDateTime::fromString(QString::fromLatin1(text.data(), static_cast<int>(text.size())), Qt::ISODateWithMs);
+					hasTime = dateTime.isValid();
+					if (hasTime) {
+						tp.timeMs = dateTime.toMSecsSinceEpoch();
+					} else {
+						warnAboutValue(reader, doDebugOutput, text);
+					}
+				}
+			}
+			else if (XmlPullReader::NameEquals(name, "Position")) {
+				double latitudeDegrees = Trackpoint::INVALID_VALUE;
+				double longitudeDegrees = Trackpoint::INVALID_VALUE;
+				readChildElements(reader, "Position", [&](std::string_view childName) {
+					if (XmlPullReader::NameEquals(childName, "LatitudeDegrees")) {
+						decodeDouble(reader, doDebugOutput, latitudeDegrees);
+						return true;
+					}
+					else if (XmlPullReader::NameEquals(childName, "LongitudeDegrees")) {
+						decodeDouble(reader, doDebugOutput, longitudeDegrees);
+						return true;
+					}
+					return false;
+				});
+				tp.latitudeDegrees = latitudeDegrees;
+				tp.longitudeDegrees = longitudeDegrees;
+			}
+			else if (XmlPullReader::NameEquals(name, "AltitudeMeters")) {
+				decodeDouble(reader, doDebugOutput, tp.altitudeMeters);
+			}
+			else if (XmlPullReader::NameEquals(name, "DistanceMeters")) {
+				decodeDouble(reader, doDebugOutput, tp.distanceMeters);
+			}
+			else if (XmlPullReader::NameEquals(name, "HeartRateBpm")) {
+				readChildElements(reader, "HeartRateBpm", [&](std::string_view childName) {
+					if (!XmlPullReader::NameEquals(childName, "Value")) return false;
+					decodeInteger(reader, doDebugOutput, tp.heartRateBpm);
+					return true;
+				});
+			}
+			else if (XmlPullReader::NameEquals(name, "Cadence")) {
+				decodeInteger(reader, doDebugOutput, tp.cadenceRpm);
+			}
+			else if (XmlPullReader::NameEquals(name, "Extensions")) {
+				// Garmin's activity extension, e.g. <ns3:TPX><ns3:RunCadence>82</ns3:RunCadence><ns3:Watts>250</ns3:Watts></ns3:TPX>
+				readChildElements(reader, "Extensions", [&](std::string_view extensionName) {
+					if (!XmlPullReader::NameEquals(extensionName, "TPX")) return false;
+					readChildElements(reader, "TPX", [&](std::string_view childName) {
+						if (XmlPullReader::NameEquals(childName, "Watts")) {
+							decodeInteger(reader, doDebugOutput, tp.powerWatts);
+							return true;
+						}
+						else if (XmlPullReader::NameEquals(childName, "RunCadence")) {
+							std::int_fast16_t runCadence = Trackpoint::INVALID_CADENCE;
+							decodeInteger(reader, doDebugOutput, runCadence);
+							if (!tp.HasCadence()) tp.cadenceRpm = runCadence;
+							return true;
+						}
+						return false;
+					});
+					return true;
+				});
+			}
+			else {
+				return false;
+			}
+			return true;
+		});
+		return hasTime;
+	}
 
-			auto const children = trackpointNode.childNodes();
-			if (children.size() != 5) {
-				std::cerr << "Assumption Error: Expected Trackpoint to have 5 children, but it has " << children.size() << "!" << std::endl;
-				throw;
+	// Reads Trackpoint elements until the end of the enclosing element, or of the input if the reader only sees a part of the Track, and returns that token.
+	// Errors of the reader between trackpoints are returned as well, errors within a trackpoint throw. Other elements than Trackpoint are skipped.
+	// Trackpoints are handed to sink as they are, i.e. without the distance fix-up.
+	// Every PROGRESS_INTERVAL trackpoints, progress is called with the offset of the reader and parsing is cancelled if it returns false.
+	template<typename Sink, typename Progress>
+	XmlPullReader::Token parseTrackpoints(XmlPullReader& reader, bool doDebugOutput, Sink&& sink, Progress&& progress) const {
+		using Token = XmlPullReader::Token;
+		for (std::size_t i = 0; ; ++i) {
+			if ((i % PROGRESS_INTERVAL) == (PROGRESS_INTERVAL - 1) && !progress(reader.GetPosition())) {
+				throw ParseCancelled();
+			}
+			auto const token = reader.ReadNext();
+			if (token == Token::EndElement || token == Token::EndOfDocument || token == Token::Error) {
+				return token;
+			}
+			else if (token != Token::StartElement) {
+				reportStreamingError(reader, "Assumption Error: Node was expected to be a Trackpoint element, but it was not.");
+			}
+			else if (!XmlPullReader::NameEquals(reader.GetName(), "Trackpoint")) {
+				if (!reader.SkipCurrentElement()) {
+					reportStreamingError(reader, "Error: Failed to skip element.");
+				}
+				continue;
 			}
 
 			Trackpoint tp;
+			if (!readTrackpoint(reader, doDebugOutput, tp)) {
+				if (doDebugOutput) std::cerr << "Warning: Ignoring trackpoint #" << i << " without time!" << std::endl;
+				continue;
+			}
 
-			auto const childTime = ensureIsElement(getChildByType(trackpointNode, "Time"));
-			tp.dateTime = QDateTime::fromString(childTime.text(), Qt::ISODateWithMs);
+			sink(tp);
+		}
+	}
 
-			if (tp.dateTime.toString("zzz").compare("000") != 0) {
-				if (doDebugOutput) std::cerr << "Warning: Ignoring trackpoint #" << i << " not on second boundary!" << std::endl;
-				continue;
+	// Finds the next start tag of an element with the given qualified name at or after offset.
+	static inline std::size_t findStartTag(std::string_view content, std::string_view qualifiedName, std::size_t offset) {
+		while (offset < content.size()) {
+			offset = content.find(qualifiedName, offset);
+			if (offset == std::string_view::npos) return offset;
+			std::size_t const nameEnd = offset + qualifiedName.size();
+			if (offset > 0 && content[offset - 1] == '<' && nameEnd < content.size() && (content[nameEnd] == '>' || content[nameEnd] == '/' || content[nameEnd] == ' ' || content[nameEnd] == '\t' || content[nameEnd] == '\r' || content[nameEnd] == '\n')) {
+				return offset - 1;
 			}
-			
-			auto const childPosition = ensureIsElement(getChildByType(trackpointNode, "Position"));
-			auto const lat = ensureIsElement(getChildAtIndex(childPosition, 0, "LatitudeDegrees"));
-			auto const lon = ensureIsElement(getChildAtIndex(childPosition, 1, "LongitudeDegrees"));
-			tp.latitudeDegrees = std::stod(lat.text().toStdString());
-			tp.longitudeDegrees = std::stod(lon.text().toStdString());
+			offset = nameEnd;
+		}
+		return std::string_view::npos;
+	}
 
+	// Finds the next end tag of an element with the given qualified name at or after offset.
+	static inline std::size_t findEndTag(std::string_view content, std::string_view qualifiedName, std::size_t offset) {
+		while (offset < content.size()) {
+			offset = content.find(qualifiedName, offset);
+			if (offset == std::string_view::npos) return offset;
+			std::size_t const nameEnd = offset + qualifiedName.size();
+			if (offset > 1 && content[offset - 2] == '<' && content[offset - 1] == '/' && nameEnd < content.size() && (content[nameEnd] == '>' || content[nameEnd] == ' ' || content[nameEnd] == '\t' || content[nameEnd] == '\r' || content[nameEnd] == '\n')) {
+				return offset - 2;
+			}
+			offset = nameEnd;
+		}
+		return std::string_view::npos;
+	}
+
+	// Splits the content of the Track element the reader is on at Trackpoint boundaries, parses the parts on threadCount threads
+	// and hands the trackpoints to sink in document order. On success, the reader is left on the EndElement of the Track.
+	// The split points are spread over the Track up to the first text match of its end tag. As that might not be the real end, the last part runs to the end of the file
+	// and every part watches out for the end tag of the Track.
+	// Parts after the one that found it are dropped. The split points are found by plain text search, so a part can start in the wrong place (e.g. inside a comment).
+	// Parts like that fail to parse, in which case false is returned and the reader was not moved, so the caller can parse the Track on a single thread instead.
+	// Warnings of the parts are not printed, as they could not say which trackpoint they are about.
+	// Progress is summed up over all parts and reported from the thread of the first part, if it asks to cancel, all parts stop and ParseCancelled is thrown.
+	template<typename Sink, typename Progress>
+	bool parseTrackpointsParallel(XmlPullReader& reader, std::string_view content, unsigned int threadCount, bool doDebugOutput, Sink&& sink, Progress&& progress) const {
+		using Token = XmlPullReader::Token;
+		if (reader.IsEmptyElement()) {
+			return false;
+		}
+		std::string_view const trackName = reader.GetQualifiedName();
+		std::size_t const bodyStart = reader.GetPosition();
 
-			auto const childAltitude = ensureIsElement(getChildByType(trackpointNode, "AltitudeMeters"));
-			tp.altitudeMeters = std::stod(childAltitude.text().toStdString());
+		XmlPullReader firstChildReader(content.substr(bodyStart));
+		if (firstChildReader.ReadNext() != Token::StartElement) {
+			return false;
+		}
+		std::string_view const trackpointName = firstChildReader.GetQualifiedName();
+
+		std::vector<std::size_t> partStarts = { bodyStart + firstChildReader.GetTokenOffset() };
+		std::size_t const approximateEnd = std::min(findEndTag(content, trackName, partStarts.front()), content.size());
+		std::size_t const approximateSize = approximateEnd - partStarts.front();
+		std::size_t const targetPartCount = std::min<std::size_t>(threadCount, approximateSize / PARALLEL_PARSING_MIN_PART_SIZE);
+		if (targetPartCount < 2) {
+			return false;
+		}
+		for (std::size_t i = 1; i < targetPartCount; ++i) {
+			std::size_t const target = std::max(partStarts.front() + (approximateSize / targetPartCount) * i, partStarts.back() + 1);
+			std::size_t const partStart = findStartTag(content, trackpointName, target);
+			if (partStart == std::string_view::npos) break;
+			partStarts.push_back(partStart);
+		}
+		partStarts.push_back(content.size());
 
-			auto const childDistance = ensureIsElement(getChildByType(trackpointNode, "DistanceMeters"));
-			tp.distanceMeters = std::stod(childDistance.text().toStdString());
+		std::size_t const partCount = partStarts.size() - 1;
+		std::vector<std::vector<Trackpoint>> parts(partCount);
+		std::vector<char> partFailed(partCount, 0);
+		std::vector<std::size_t> partTrackEnd(partCount, std::string_view::npos);
+		// Index of the first part known to contain the end of the Track, later parts can stop right away
+		std::atomic<std::size_t> endingPart = partCount;
+		struct PartCancelled {};
+		std::atomic<std::size_t> bytesDone = partStarts.front();
+		std::atomic<bool> isCancelled = false;
+		{
+			std::vector<std::jthread> threads;
+			threads.reserve(partCount);
+			for (std::size_t i = 0; i < partCount; ++i) {
+				threads.emplace_back([&, i]() {
+					TRACE_SCOPE("Parse part of track");
+					try {
+						std::string_view const partContent = content.substr(partStarts[i], partStarts[i + 1] - partStarts[i]);
+						XmlPullReader partReader(partContent);
+						// Roughly 200 bytes per trackpoint, reserving avoids most of the reallocations
+						parts[i].reserve(partContent.size() / 200);
+						std::size_t lastOffset = 0;
+						auto const partProgress = [&](std::size_t offset) {
+							std::size_t const total = bytesDone.fetch_add(offset - lastOffset, std::memory_order_relaxed) + (offset - lastOffset);
+							lastOffset = offset;
+							if (i == 0 && !progress(std::min(total, content.size()))) {
+								isCancelled = true;
+							}
+							return !isCancelled.load(std::memory_order_relaxed);
+						};
+						auto const token = parseTrackpoints(partReader, false, [&](Trackpoint const& tp) {
+							if (i > endingPart.load(std::memory_order_relaxed)) throw PartCancelled();
+							parts[i].push_back(tp);
+						}, partProgress);
 
-			if (tp.distanceMeters < lastDistanceInMeters) {
-				if (doDebugOutput) std::cerr << "Warning: Fixing distance on point #" << i << "!" << std::endl;
-				tp.distanceMeters = lastDistanceInMeters;
+						bool const isTrackEnd = (token == Token::Error) && (partReader.GetDepth() == 0) && (partReader.GetQualifiedName() == trackName) && partContent.substr(partReader.GetTokenOffset()).starts_with("</");
+						if (isTrackEnd) {
+							partTrackEnd[i] = partStarts[i] + partReader.GetTokenOffset();
+							std::size_t expected = endingPart.load();
+							while (i < expected && !endingPart.compare_exchange_weak(expected, i)) {}
+						}
+						else if (token != Token::EndOfDocument || (i + 1) == partCount) {
+							partFailed[i] = 1;
+						}
+					}
+					catch (PartCancelled const&) {
+						partFailed[i] = 1;
+					}
+					catch (std::exception const&) {
+						partFailed[i] = 1;
+					}
+				});
 			}
-			lastDistanceInMeters = tp.distanceMeters;
+		}
 
-			auto const childHeartRate = ensureIsElement(getChildByType(trackpointNode, "HeartRateBpm"));
-			auto const value = ensureIsElement(getChildAtIndex(childHeartRate, 0, "Value"));
-			tp.heartRateBpm = std::stoi(value.text().toStdString());
+		if (isCancelled) {
+			throw ParseCancelled();
+		}
+		std::size_t const lastPart = endingPart.load();
+		if (lastPart == partCount || std::find(partFailed.begin(), partFailed.begin() + lastPart + 1, 1) != partFailed.begin() + lastPart + 1) {
+			if (doDebugOutput) std::cerr << "Warning: Failed to parse the Track in parallel, falling back to a single thread." << std::endl;
+			return false;
+		}
 
-			result.push_back(tp);
+		for (std::size_t i = 0; i <= lastPart; ++i) {
+			for (auto const& tp : parts[i]) {
+				sink(tp);
+			}
 		}
+		if (doDebugOutput) std::cerr << "Parsed Track in " << (lastPart + 1) << " parts in parallel." << std::endl;
 
-		return result;
+		reader.SkipTo(partTrackEnd[lastPart]);
+		if (reader.ReadNext() != Token::EndElement) {
+			reportStreamingError(reader, "Error: Expected the end of the Track.");
+		}
+		return true;
+	}
+
+	// Same results as ParseActivities, but every Trackpoint is appended to track as soon as it has been read, in a single pass over the file.
+	// Large tracks are parsed on up to threadCount threads, see parseTrackpointsParallel().
+	template<typename Progress>
+	void ParseActivitiesStreaming(std::string_view content, bool doDebugOutput, unsigned int threadCount, Track& track, Progress&& progress) const {
+		using Token = XmlPullReader::Token;
+		XmlPullReader reader(content);
+
+		expectStartElement(reader, "TrainingCenterDatabase");
+		if (!findChildByType(reader, "Activities")) {
+			reportStreamingError(reader, "Assumption Error: Node was expected to have a child of type 'Activities', but it did not.");
+		}
+
+		// Distances start over with every activity, but have to be monotonic within one.
+		// This is applied in document order after parsing, so it does not matter how a Track was split up for that.
+		double lastDistanceInMeters = 0.0;
+		std::size_t pointIndex = 0;
+		auto const fixDistance = [&](Trackpoint tp) {
+			if (tp.HasDistance()) {
+				if (tp.distanceMeters < lastDistanceInMeters) {
+					if (doDebugOutput) std::cerr << "Warning: Fixing distance on point #" << pointIndex << "!" << std::endl;
+					tp.distanceMeters = lastDistanceInMeters;
+				}
+				lastDistanceInMeters = tp.distanceMeters;
+			}
+			++pointIndex;
+			track.Append(tp);
+		};
+
+		bool const parseInParallel = (threadCount > 1) && (content.size() >= PARALLEL_PARSING_MIN_FILE_SIZE);
+		while (findChildByType(reader, "Activity")) {
+			auto const sportAttribute = reader.GetAttribute("Sport");
+			if (!sportAttribute.has_value()) {
+				if (doDebugOutput) std::cerr << "Warning: Activity in line " << reader.GetLineNumber() << " has no Sport, assuming 'Other'." << std::endl;
+			}
+			track.BeginActivity(GetSportByName(sportAttribute.value_or("Other")));
+			lastDistanceInMeters = 0.0;
+
+			bool isFirstLap = true;
+			while (findChildByType(reader, "Lap")) {
+				if (!isFirstLap) track.BeginLap();
+				isFirstLap = false;
+
+				// A lap usually has one Track, but there can be several (e.g. after a pause) or none at all
+				while (findChildByType(reader, "Track")) {
+					if (parseInParallel && parseTrackpointsParallel(reader, content, threadCount, doDebugOutput, fixDistance, progress)) {
+						continue;
+					}
+					auto const token = parseTrackpoints(reader, doDebugOutput, fixDistance, progress);
+					if (token == Token::Error) {
+						reportStreamingError(reader, "Error: Failed to read Track.");
+					}
+					else if (token != Token::EndElement) {
+						reportStreamingError(reader, "Error: Unexpected end of document in Track.");
+					}
+				}
+			}
+		}
+
+		if (track.GetActivityStarts().empty()) {
+			reportStreamingError(reader, "Assumption Error: Node was expected to have a child of type 'Activity', but it did not.");
+		}
 	}
 };
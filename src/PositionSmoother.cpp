@@ -0,0 +1,152 @@
+#include "PositionSmoother.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Trace.hpp"
+
+static constexpr double EARTH_RADIUS_METERS = 6371008.8;
+static constexpr double RADIANS_PER_DEGREE = 3.14159265358979323846 / 180.0;
+// Variance of the velocity at the start of a run, where nothing is known about it yet
+static constexpr double INITIAL_VELOCITY_VARIANCE = 100.0;
+
+namespace {
+	struct Prediction {
+		double x;
+		double vx;
+		double y;
+		double vy;
+		double p00;
+		double p01;
+		double p11;
+	};
+
+	// Moves a state dt seconds ahead with constant velocity, the covariance grows by the random acceleration in between
+	template<typename State>
+	inline Prediction Predict(State const& state, double dt, double accelerationVariance) {
+		double const dt2 = dt * dt;
+		return {
+			state.x + dt * state.vx,
+			state.vx,
+			state.y + dt * state.vy,
+			state.vy,
+			state.p00 + 2.0 * dt * state.p01 + dt2 * state.p11 + accelerationVariance * dt2 * dt2 / 4.0,
+			state.p01 + dt * state.p11 + accelerationVariance * dt2 * dt / 2.0,
+			state.p11 + accelerationVariance * dt2
+		};
+	}
+
+	inline double WrapLongitude(double degrees) {
+		if (degrees > 180.0) return degrees - 360.0;
+		if (degrees < -180.0) return degrees + 360.0;
+		return degrees;
+	}
+}
+
+void PositionSmoother::Apply(Track const& track) {
+	TRACE_SCOPE("Smooth positions");
+	static constexpr std::size_t NO_RUN = std::numeric_limits<std::size_t>::max();
+
+	std::size_t const size = track.Size();
+	m_latitudeDegrees.assign(track.GetLatitudeDegrees().begin(), track.GetLatitudeDegrees().end());
+	m_longitudeDegrees.assign(track.GetLongitudeDegrees().begin(), track.GetLongitudeDegrees().end());
+	m_states.resize(size);
+
+	auto const& timeMs = track.GetTimeMs();
+	auto const& hasPosition = track.GetPositionValidity();
+	auto const& activityStarts = track.GetActivityStarts();
+	std::size_t nextActivity = 0;
+	std::size_t runBegin = NO_RUN;
+	for (std::size_t i = 0; i < size; ++i) {
+		bool isActivityStart = false;
+		while (nextActivity < activityStarts.size() && activityStarts[nextActivity] <= i) {
+			isActivityStart = isActivityStart || activityStarts[nextActivity] == i;
+			++nextActivity;
+		}
+		bool const continuesRun = runBegin != NO_RUN && hasPosition.Test(i) && !isActivityStart && timeMs[i] > timeMs[i - 1] && (timeMs[i] - timeMs[i - 1]) <= MAX_GAP_MS;
+		if (!continuesRun) {
+			if (runBegin != NO_RUN) smoothRun(track, runBegin, i);
+			runBegin = hasPosition.Test(i) ? i : NO_RUN;
+		}
+	}
+	if (runBegin != NO_RUN) smoothRun(track, runBegin, size);
+}
+
+void PositionSmoother::smoothRun(Track const& track, std::size_t begin, std::size_t end) {
+	auto const& timeMs = track.GetTimeMs();
+	auto const& latitudeDegrees = track.GetLatitudeDegrees();
+	auto const& longitudeDegrees = track.GetLongitudeDegrees();
+
+	// Meters east and north of the first position of the run, which is accurate enough over the distances of an activity
+	double const referenceLatitude = latitudeDegrees[begin];
+	double const referenceLongitude = longitudeDegrees[begin];
+	double const metersPerDegreeLatitude = EARTH_RADIUS_METERS * RADIANS_PER_DEGREE;
+	double const metersPerDegreeLongitude = metersPerDegreeLatitude * std::max(std::cos(referenceLatitude * RADIANS_PER_DEGREE), 1e-6);
+	auto const getX = [&](std::size_t i) {
+		return WrapLongitude(longitudeDegrees[i] - referenceLongitude) * metersPerDegreeLongitude;
+	};
+	auto const getY = [&](std::size_t i) {
+		return (latitudeDegrees[i] - referenceLatitude) * metersPerDegreeLatitude;
+	};
+	auto const getSeconds = [&](std::size_t i) {
+		return static_cast<double>(timeMs[i + 1] - timeMs[i]) / 1000.0;
+	};
+
+	double const measurementVariance = MEASUREMENT_NOISE_METERS * MEASUREMENT_NOISE_METERS;
+	double const accelerationVariance = ACCELERATION_NOISE_METERS_PER_SECOND_SQUARED * ACCELERATION_NOISE_METERS_PER_SECOND_SQUARED;
+
+	// Forward pass, the Kalman filter
+	m_states[begin] = { getX(begin), 0.0, getY(begin), 0.0, measurementVariance, 0.0, INITIAL_VELOCITY_VARIANCE };
+	for (std::size_t i = begin + 1; i < end; ++i) {
+		Prediction const predicted = Predict(m_states[i - 1], getSeconds(i - 1), accelerationVariance);
+		double const inverseInnovationVariance = 1.0 / (predicted.p00 + measurementVariance);
+		double const positionGain = predicted.p00 * inverseInnovationVariance;
+		double const velocityGain = predicted.p01 * inverseInnovationVariance;
+		double const errorX = getX(i) - predicted.x;
+		double const errorY = getY(i) - predicted.y;
+		m_states[i] = {
+			predicted.x + positionGain * errorX,
+			predicted.vx + velocityGain * errorX,
+			predicted.y + positionGain * errorY,
+			predicted.vy + velocityGain * errorY,
+			(1.0 - positionGain) * predicted.p00,
+			(1.0 - positionGain) * predicted.p01,
+			predicted.p11 - velocityGain * predicted.p01
+		};
+	}
+
+	// Backward pass: corrects every filtered state by how far the smoothed successor is off from what the state predicted for it
+	auto const store = [&](std::size_t i, double x, double y) {
+		m_latitudeDegrees[i] = referenceLatitude + y / metersPerDegreeLatitude;
+		m_longitudeDegrees[i] = WrapLongitude(referenceLongitude + x / metersPerDegreeLongitude);
+	};
+	FilterState smoothed = m_states[end - 1];
+	store(end - 1, smoothed.x, smoothed.y);
+	for (std::size_t i = end - 1; i-- > begin;) {
+		FilterState const& filtered = m_states[i];
+		double const dt = getSeconds(i);
+		Prediction const predicted = Predict(filtered, dt, accelerationVariance);
+
+		// Gain = filtered covariance * transposed transition * inverse of the predicted covariance
+		double const a00 = filtered.p00 + dt * filtered.p01;
+		double const a01 = filtered.p01;
+		double const a10 = filtered.p01 + dt * filtered.p11;
+		double const a11 = filtered.p11;
+		double const inverseDeterminant = 1.0 / (predicted.p00 * predicted.p11 - predicted.p01 * predicted.p01);
+		double const g00 = (a00 * predicted.p11 - a01 * predicted.p01) * inverseDeterminant;
+		double const g01 = (a01 * predicted.p00 - a00 * predicted.p01) * inverseDeterminant;
+		double const g10 = (a10 * predicted.p11 - a11 * predicted.p01) * inverseDeterminant;
+		double const g11 = (a11 * predicted.p00 - a10 * predicted.p01) * inverseDeterminant;
+
+		double const errorX = smoothed.x - predicted.x;
+		double const errorVx = smoothed.vx - predicted.vx;
+		double const errorY = smoothed.y - predicted.y;
+		double const errorVy = smoothed.vy - predicted.vy;
+		smoothed.x = filtered.x + g00 * errorX + g01 * errorVx;
+		smoothed.vx = filtered.vx + g10 * errorX + g11 * errorVx;
+		smoothed.y = filtered.y + g00 * errorY + g01 * errorVy;
+		smoothed.vy = filtered.vy + g10 * errorY + g11 * errorVy;
+		store(i, smoothed.x, smoothed.y);
+	}
+}
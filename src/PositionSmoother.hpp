@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Track.hpp"
+
+// Smooths the GPS positions of a track with a Kalman filter and a Rauch-Tung-Striebel smoother (the filter run backwards over its own result),
+// so there is no lag. Each axis is modelled as position and velocity in meters, driven by random accelerations and measured with GPS noise.
+// Every run of valid positions is smoothed on its own: missing positions, time going backwards, gaps of more than MAX_GAP_MS and new activities start a new one.
+// Takes O(n) time, the buffers are kept between calls.
+class PositionSmoother {
+public:
+	// Standard deviation of a GPS position
+	static constexpr double MEASUREMENT_NOISE_METERS = 5.0;
+	// Standard deviation of the acceleration, about what running or riding has
+	static constexpr double ACCELERATION_NOISE_METERS_PER_SECOND_SQUARED = 1.0;
+	static constexpr std::int64_t MAX_GAP_MS = 10000;
+
+	// Smooths the positions of the track into GetLatitudeDegrees() and GetLongitudeDegrees(), which then have one value per sample.
+	// Invalid positions (see Track::GetPositionValidity()) are copied as they are.
+	void Apply(Track const& track);
+
+	inline std::span<double const> GetLatitudeDegrees() const {
+		return m_latitudeDegrees;
+	}
+	inline std::span<double const> GetLongitudeDegrees() const {
+		return m_longitudeDegrees;
+	}
+private:
+	// Filtered state of one sample: position and velocity per axis, and the covariance, which is the same for both axes
+	struct FilterState {
+		double x;
+		double vx;
+		double y;
+		double vy;
+		double p00;
+		double p01;
+		double p11;
+	};
+
+	std::vector<double> m_latitudeDegrees;
+	std::vector<double> m_longitudeDegrees;
+	std::vector<FilterState> m_states;
+
+	void smoothRun(Track const& track, std::size_t begin, std::size_t end);
+};
@@ -0,0 +1,109 @@
+#include "Resampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "Trace.hpp"
+
+// Multiples of the interval at or after (or at or before) the given time, also for times before the epoch
+static inline std::int64_t CeilToInterval(std::int64_t timeMs, std::int64_t intervalMs) {
+	std::int64_t const remainder = timeMs % intervalMs;
+	if (remainder == 0) return timeMs;
+	return (remainder > 0) ? (timeMs - remainder + intervalMs) : (timeMs - remainder);
+}
+
+static inline std::int64_t FloorToInterval(std::int64_t timeMs, std::int64_t intervalMs) {
+	std::int64_t const remainder = timeMs % intervalMs;
+	return (remainder >= 0) ? (timeMs - remainder) : (timeMs - remainder - intervalMs);
+}
+
+void Resample(Track const& input, ResampleOptions const& options, Track& output) {
+	TRACE_SCOPE("Resample");
+	if (options.intervalMs < 1) {
+		throw std::invalid_argument("Error: The resampling interval has to be at least 1ms, but it was " + std::to_string(options.intervalMs) + "ms!");
+	}
+	output.Clear();
+	if (input.Empty()) return;
+
+	auto const& timeMs = input.GetTimeMs();
+	auto const& latitudeDegrees = input.GetLatitudeDegrees();
+	auto const& longitudeDegrees = input.GetLongitudeDegrees();
+	auto const& altitudeMeters = input.GetAltitudeMeters();
+	auto const& distanceMeters = input.GetDistanceMeters();
+	auto const& heartRateBpm = input.GetHeartRateBpm();
+	auto const& cadenceRpm = input.GetCadenceRpm();
+	auto const& powerWatts = input.GetPowerWatts();
+	auto const& hasPosition = input.GetPositionValidity();
+	auto const& hasAltitude = input.GetAltitudeValidity();
+	auto const& hasDistance = input.GetDistanceValidity();
+	auto const& hasHeartRate = input.GetHeartRateValidity();
+	auto const& hasCadence = input.GetCadenceValidity();
+	auto const& hasPower = input.GetPowerValidity();
+	auto const& activityStarts = input.GetActivityStarts();
+	auto const& activitySports = input.GetActivitySports();
+	auto const& lapStarts = input.GetLapStarts();
+
+	std::size_t const size = input.Size();
+	std::int64_t const firstGridTimeMs = CeilToInterval(timeMs.front(), options.intervalMs);
+	std::int64_t const lastGridTimeMs = FloorToInterval(*std::max_element(timeMs.begin(), timeMs.end()), options.intervalMs);
+	if (lastGridTimeMs < firstGridTimeMs) return;
+	std::uint64_t const gridSize = static_cast<std::uint64_t>((lastGridTimeMs - firstGridTimeMs) / options.intervalMs) + 1;
+	if (gridSize > MAX_RESAMPLED_SIZE) {
+		throw std::runtime_error("Error: Resampling would create " + std::to_string(gridSize) + " samples, the times of the track are probably broken!");
+	}
+	output.Reserve(static_cast<std::size_t>(gridSize));
+
+	// Sample at or before the current grid point (the latest one not going back in time), and the sample following it in the file
+	std::size_t previous = 0;
+	std::size_t next = 1;
+	std::size_t nextActivity = 0;
+	std::size_t nextLap = 0;
+	std::size_t currentActivityStart = 0;
+
+	for (std::int64_t gridTimeMs = firstGridTimeMs; gridTimeMs <= lastGridTimeMs; gridTimeMs += options.intervalMs) {
+		while (next < size && timeMs[next] <= gridTimeMs) {
+			if (timeMs[next] >= timeMs[previous]) previous = next;
+			++next;
+		}
+
+		// Activities and laps whose first sample has been passed start here. The first lap of an activity is started by the activity.
+		while (nextActivity < activityStarts.size() && activityStarts[nextActivity] < next) {
+			output.BeginActivity(activitySports[nextActivity]);
+			currentActivityStart = static_cast<std::size_t>(activityStarts[nextActivity]);
+			++nextActivity;
+		}
+		while (nextLap < lapStarts.size() && lapStarts[nextLap] < next) {
+			if (!std::binary_search(activityStarts.begin(), activityStarts.end(), lapStarts[nextLap])) output.BeginLap();
+			++nextLap;
+		}
+
+		Trackpoint tp;
+		if (timeMs[previous] == gridTimeMs) {
+			tp = input.At(previous);
+		}
+		else if (next < size && previous >= currentActivityStart && (nextActivity >= activityStarts.size() || activityStarts[nextActivity] != next)
+			&& (timeMs[next] - timeMs[previous]) <= options.maxGapMs) {
+			double const weight = static_cast<double>(gridTimeMs - timeMs[previous]) / static_cast<double>(timeMs[next] - timeMs[previous]);
+			auto const interpolate = [weight, previous, next](auto const& values) {
+				return static_cast<double>(values[previous]) + (static_cast<double>(values[next]) - static_cast<double>(values[previous])) * weight;
+			};
+			auto const isValid = [previous, next](ValidityMask const& mask) {
+				return mask.Test(previous) && mask.Test(next);
+			};
+
+			if (isValid(hasPosition)) {
+				tp.latitudeDegrees = interpolate(latitudeDegrees);
+				tp.longitudeDegrees = interpolate(longitudeDegrees);
+			}
+			if (isValid(hasAltitude)) tp.altitudeMeters = interpolate(altitudeMeters);
+			if (isValid(hasDistance)) tp.distanceMeters = interpolate(distanceMeters);
+			if (isValid(hasHeartRate)) tp.heartRateBpm = static_cast<std::int_fast16_t>(std::lround(interpolate(heartRateBpm)));
+			if (isValid(hasCadence)) tp.cadenceRpm = static_cast<std::int_fast16_t>(std::lround(interpolate(cadenceRpm)));
+			if (isValid(hasPower)) tp.powerWatts = static_cast<std::int_fast32_t>(std::lround(interpolate(powerWatts)));
+		}
+		tp.timeMs = gridTimeMs;
+		output.Append(tp);
+	}
+}
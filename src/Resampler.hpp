@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Track.hpp"
+
+// How a track is brought onto a uniform time grid before deriving series from it.
+struct ResampleOptions {
+	// Time between two samples of the grid, 1000 gives one sample per second
+	std::int64_t intervalMs;
+	// Samples further apart than this are not interpolated between, the grid points in between are missing
+	std::int64_t maxGapMs;
+
+	ResampleOptions() : intervalMs(1000), maxGapMs(10000) {}
+
+	inline bool HasSameComputation(ResampleOptions const& other) const {
+		return intervalMs == other.intervalMs && maxGapMs == other.maxGapMs;
+	}
+};
+
+// Grids spanning more samples than this are refused, as they come from broken timestamps rather than from an activity (194 days at 1 Hz).
+static constexpr std::size_t MAX_RESAMPLED_SIZE = std::size_t(1) << 24;
+
+// Resamples the track onto the times that are multiples of options.intervalMs, from the first to the last sample of the input, in one pass.
+// Every value of a grid point is linearly interpolated between the samples before and after it (heart rate, cadence and power are rounded),
+// or taken as is if a sample lies exactly on the grid point. A value is missing if it is missing in one of the two samples,
+// or if they are more than options.maxGapMs apart or belong to different activities. Samples going back in time are skipped.
+// Activities and laps start at the first grid point at or after their first sample.
+// The output is cleared first and may not be the input. Throws std::invalid_argument for an interval below 1,
+// and std::runtime_error if the grid would have more than MAX_RESAMPLED_SIZE samples.
+void Resample(Track const& input, ResampleOptions const& options, Track& output);
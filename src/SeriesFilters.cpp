@@ -0,0 +1,369 @@
+#include "SeriesFilters.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "SeriesKernels.hpp"
+
+namespace {
+	// The last bit of a heap position tells which of the two heaps it is in
+	constexpr std::size_t UPPER_HEAP_TAG = ~(~std::size_t(0) >> 1);
+
+	// Binary heap in a buffer it does not own, which records the position of every entry so that any of them can be removed in O(log n).
+	// The position of the entry with id i is kept in positions[i % positions.size()], so at most positions.size() consecutive ids may be in it.
+	template<typename Entry, bool IS_MAX_HEAP>
+	class TrackedHeap {
+	public:
+		TrackedHeap(std::vector<Entry>& entries, std::vector<std::size_t>& positions, std::size_t tag) : m_entries(entries), m_positions(positions), m_tag(tag) {
+			m_entries.clear();
+		}
+
+		inline std::size_t Size() const {
+			return m_entries.size();
+		}
+		inline Entry const& Top() const {
+			return m_entries.front();
+		}
+		void Push(Entry const& entry) {
+			m_entries.push_back(entry);
+			siftUp(m_entries.size() - 1);
+		}
+		Entry Pop() {
+			Entry const top = m_entries.front();
+			RemoveAt(0);
+			return top;
+		}
+		void RemoveAt(std::size_t index) {
+			std::size_t const last = m_entries.size() - 1;
+			if (index != last) {
+				m_entries[index] = m_entries[last];
+				m_entries.pop_back();
+				siftDown(siftUp(index));
+			}
+			else {
+				m_entries.pop_back();
+			}
+		}
+	private:
+		std::vector<Entry>& m_entries;
+		std::vector<std::size_t>& m_positions;
+		std::size_t const m_tag;
+
+		static inline bool isAbove(double a, double b) {
+			return IS_MAX_HEAP ? (a > b) : (a < b);
+		}
+		inline void place(std::size_t index, Entry const& entry) {
+			m_entries[index] = entry;
+			m_positions[entry.id % m_positions.size()] = index | m_tag;
+		}
+		std::size_t siftUp(std::size_t index) {
+			Entry const entry = m_entries[index];
+			while (index > 0) {
+				std::size_t const parent = (index - 1) / 2;
+				if (!isAbove(entry.value, m_entries[parent].value)) break;
+				place(index, m_entries[parent]);
+				index = parent;
+			}
+			place(index, entry);
+			return index;
+		}
+		void siftDown(std::size_t index) {
+			Entry const entry = m_entries[index];
+			std::size_t const size = m_entries.size();
+			while (true) {
+				std::size_t child = 2 * index + 1;
+				if (child >= size) break;
+				if (child + 1 < size && isAbove(m_entries[child + 1].value, m_entries[child].value)) ++child;
+				if (!isAbove(m_entries[child].value, entry.value)) break;
+				place(index, m_entries[child]);
+				index = child;
+			}
+			place(index, entry);
+		}
+	};
+
+	// Widths of three successive box filters whose combination approximates a Gaussian of the given standard deviation
+	// (after W. Jarosz, "Fast Image Convolutions", and P. Kovesi, "Fast Almost-Gaussian Filtering"). All widths are odd.
+	std::array<std::size_t, 3> GetGaussianBoxWidths(double sigma) {
+		double const idealWidth = std::sqrt(4.0 * sigma * sigma + 1.0);
+		std::size_t lowerWidth = static_cast<std::size_t>(std::floor(idealWidth));
+		if (lowerWidth % 2 == 0) --lowerWidth;
+		double const lower = static_cast<double>(lowerWidth);
+		double const idealLowerCount = (12.0 * sigma * sigma - 3.0 * lower * lower - 12.0 * lower - 9.0) / (-4.0 * lower - 4.0);
+		std::size_t const lowerCount = static_cast<std::size_t>(std::clamp(std::round(idealLowerCount), 0.0, 3.0));
+		std::array<std::size_t, 3> result;
+		for (std::size_t i = 0; i < result.size(); ++i) {
+			result[i] = (i < lowerCount) ? lowerWidth : (lowerWidth + 2);
+		}
+		return result;
+	}
+
+	// Sums of values and weights over [i - half, i + half], where samples outside of the series count as weight 0.
+	// The weights are integers, so they are summed exactly and a weight sum of 0 really means no valid sample.
+	void CenteredBoxSums(std::span<double const> values, std::span<double const> weights, std::size_t half, std::span<double> valueSums, std::span<double> weightSums) {
+		std::size_t const size = values.size();
+		double valueSum = 0.0;
+		double weightSum = 0.0;
+		for (std::size_t j = 0; j <= std::min(half, size - 1); ++j) {
+			valueSum += values[j];
+			weightSum += weights[j];
+		}
+		for (std::size_t i = 0; i < size; ++i) {
+			valueSums[i] = valueSum;
+			weightSums[i] = weightSum;
+
+			if (i >= half) {
+				valueSum -= values[i - half];
+				weightSum -= weights[i - half];
+			}
+			if (i + 1 + half < size) {
+				valueSum += values[i + 1 + half];
+				weightSum += weights[i + 1 + half];
+			}
+			if (weightSum == 0.0) {
+				// Do not carry rounding errors over gaps
+				valueSum = 0.0;
+			}
+		}
+	}
+
+	// Moments of the valid samples of a window relative to its center c: weights[p] = sum of k^p, values[p] = sum of k^p * input[c + k]
+	struct WindowMoments {
+		std::array<std::int64_t, 5> weights{};
+		std::array<double, 3> values{};
+
+		void Add(std::int64_t k, double value) {
+			std::int64_t power = 1;
+			for (std::size_t p = 0; p < weights.size(); ++p) {
+				weights[p] += power;
+				if (p < values.size()) values[p] += static_cast<double>(power) * value;
+				power *= k;
+			}
+		}
+		void Remove(std::int64_t k, double value) {
+			std::int64_t power = 1;
+			for (std::size_t p = 0; p < weights.size(); ++p) {
+				weights[p] -= power;
+				if (p < values.size()) values[p] -= static_cast<double>(power) * value;
+				power *= k;
+			}
+		}
+		// Moves the center one sample forward, i.e. k becomes k - 1 for every sample (binomial expansion of (k - 1)^p)
+		void Shift() {
+			auto const& w = weights;
+			weights = { w[0], w[1] - w[0], w[2] - 2 * w[1] + w[0], w[3] - 3 * w[2] + 3 * w[1] - w[0], w[4] - 4 * w[3] + 6 * w[2] - 4 * w[1] + w[0] };
+			auto const& v = values;
+			values = { v[0], v[1] - v[0], v[2] - 2.0 * v[1] + v[0] };
+		}
+
+		// Value at the center of the least squares parabola through the samples, with k scaled by 1 / half to keep the system well conditioned.
+		// Without a sample at the center the parabola would extrapolate (e.g. from one side of a gap), then this is the mean instead.
+		double EvaluateFit(std::size_t half, bool hasCenter) const {
+			if (weights[0] == 0) return MISSING_VALUE;
+			// Fewer than three samples do not determine a parabola
+			if (!hasCenter || weights[0] < 3) return values[0] / static_cast<double>(weights[0]);
+
+			double const scale = 1.0 / static_cast<double>(half);
+			double const w0 = static_cast<double>(weights[0]);
+			double const w1 = static_cast<double>(weights[1]) * scale;
+			double const w2 = static_cast<double>(weights[2]) * scale * scale;
+			double const w3 = static_cast<double>(weights[3]) * scale * scale * scale;
+			double const w4 = static_cast<double>(weights[4]) * scale * scale * scale * scale;
+			double const s0 = values[0];
+			double const s1 = values[1] * scale;
+			double const s2 = values[2] * scale * scale;
+
+			// Cramer's rule for the constant coefficient of the normal equations
+			double const determinant = w0 * (w2 * w4 - w3 * w3) - w1 * (w1 * w4 - w3 * w2) + w2 * (w1 * w3 - w2 * w2);
+			double const numerator = s0 * (w2 * w4 - w3 * w3) - w1 * (s1 * w4 - w3 * s2) + w2 * (s1 * w3 - w2 * s2);
+			return numerator / determinant;
+		}
+	};
+}
+
+char const* GetFilterTypeName(FilterType filterType) {
+	switch (filterType) {
+		case FilterType::MovingAverage: return "Moving Average";
+		case FilterType::Exponential: return "Exponential";
+		case FilterType::Gaussian: return "Gaussian";
+		case FilterType::Median: return "Median";
+		case FilterType::SavitzkyGolay: return "Savitzky-Golay";
+		default: return "Unknown";
+	}
+}
+
+void SeriesFilter::Apply(std::span<double const> input, SeriesOptions const& options, std::span<double> output) {
+	if (input.empty()) return;
+	if (options.windowSize < 1) {
+		std::fill(output.begin(), output.end(), MISSING_VALUE);
+		return;
+	}
+
+	std::size_t const windowSize = static_cast<std::size_t>(options.windowSize);
+	switch (options.filterType) {
+		case FilterType::Exponential:
+			applyExponential(input, windowSize, options.cutoffMin, options.cutoffMax, output);
+			break;
+		case FilterType::Gaussian:
+			applyGaussian(input, windowSize, options.cutoffMin, options.cutoffMax, output);
+			break;
+		case FilterType::Median:
+			applyMedian(input, windowSize, options.cutoffMin, options.cutoffMax, output);
+			break;
+		case FilterType::SavitzkyGolay:
+			applySavitzkyGolay(input, windowSize, options.cutoffMin, options.cutoffMax, output);
+			break;
+		case FilterType::MovingAverage:
+		default:
+			MovingAverage(input, windowSize, options.cutoffMin, options.cutoffMax, output);
+			break;
+	}
+}
+
+void SeriesFilter::applyExponential(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	// Same smoothing factor as for the usual N-day EMA, so its center of mass lags about as much as a moving average of the window size
+	double const alpha = 2.0 / (static_cast<double>(windowSize) + 1.0);
+	double state = MISSING_VALUE;
+	std::size_t samplesSinceValid = 0;
+	for (std::size_t i = 0; i < input.size(); ++i) {
+		double const value = input[i];
+		if (value >= cutoffMin && value <= cutoffMax) {
+			state = std::isnan(state) ? value : (state + alpha * (value - state));
+			samplesSinceValid = 0;
+		}
+		else if (++samplesSinceValid >= windowSize) {
+			// Like the moving average, do not bridge gaps longer than the window
+			state = MISSING_VALUE;
+		}
+		output[i] = state;
+	}
+}
+
+void SeriesFilter::applyGaussian(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	std::size_t const size = input.size();
+	m_values.resize(size);
+	m_weights.resize(size);
+	m_valuesScratch.resize(size);
+	m_weightsScratch.resize(size);
+	for (std::size_t i = 0; i < size; ++i) {
+		bool const isValid = input[i] >= cutoffMin && input[i] <= cutoffMax;
+		m_values[i] = isValid ? input[i] : 0.0;
+		m_weights[i] = isValid ? 1.0 : 0.0;
+	}
+
+	// Normalized convolution: blurring the values and the weights alike and dividing them gives the Gaussian of the valid samples only
+	for (std::size_t const width : GetGaussianBoxWidths(static_cast<double>(windowSize) / 6.0)) {
+		if (width <= 1) continue;
+		CenteredBoxSums(m_values, m_weights, width / 2, m_valuesScratch, m_weightsScratch);
+		m_values.swap(m_valuesScratch);
+		m_weights.swap(m_weightsScratch);
+	}
+	for (std::size_t i = 0; i < size; ++i) {
+		output[i] = (m_weights[i] > 0.0) ? (m_values[i] / m_weights[i]) : MISSING_VALUE;
+	}
+}
+
+void SeriesFilter::applyMedian(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	std::size_t const size = input.size();
+	// The window of i is [i - before, i + after], i.e. centered and one longer towards the end for even sizes
+	std::size_t const before = (windowSize - 1) / 2;
+	std::size_t const after = windowSize / 2;
+	auto const isValid = [cutoffMin, cutoffMax](double value) {
+		return value >= cutoffMin && value <= cutoffMax;
+	};
+
+	m_lowerHeap.reserve(windowSize);
+	m_upperHeap.reserve(windowSize);
+	m_heapPositions.resize(windowSize);
+	// All of the lower heap are <= all of the upper heap, and the lower one has as many entries as the upper one or one more
+	TrackedHeap<HeapEntry, true> lowerHeap(m_lowerHeap, m_heapPositions, 0);
+	TrackedHeap<HeapEntry, false> upperHeap(m_upperHeap, m_heapPositions, UPPER_HEAP_TAG);
+	auto const rebalance = [&]() {
+		if (lowerHeap.Size() > upperHeap.Size() + 1) {
+			upperHeap.Push(lowerHeap.Pop());
+		}
+		else if (upperHeap.Size() > lowerHeap.Size()) {
+			lowerHeap.Push(upperHeap.Pop());
+		}
+	};
+	auto const insert = [&](std::size_t id) {
+		if (!isValid(input[id])) return;
+		if (lowerHeap.Size() == 0 || input[id] <= lowerHeap.Top().value) {
+			lowerHeap.Push({ input[id], id });
+		}
+		else {
+			upperHeap.Push({ input[id], id });
+		}
+		rebalance();
+	};
+	auto const remove = [&](std::size_t id) {
+		if (!isValid(input[id])) return;
+		std::size_t const position = m_heapPositions[id % windowSize];
+		if ((position & UPPER_HEAP_TAG) != 0) {
+			upperHeap.RemoveAt(position & ~UPPER_HEAP_TAG);
+		}
+		else {
+			lowerHeap.RemoveAt(position);
+		}
+		rebalance();
+	};
+
+	for (std::size_t j = 0; j <= std::min(after, size - 1); ++j) {
+		insert(j);
+	}
+	for (std::size_t i = 0; i < size; ++i) {
+		if (lowerHeap.Size() == 0) {
+			output[i] = MISSING_VALUE;
+		}
+		else if (lowerHeap.Size() == upperHeap.Size()) {
+			output[i] = (lowerHeap.Top().value + upperHeap.Top().value) / 2.0;
+		}
+		else {
+			output[i] = lowerHeap.Top().value;
+		}
+
+		if (i >= before) remove(i - before);
+		if (i + 1 + after < size) insert(i + 1 + after);
+	}
+}
+
+void SeriesFilter::applySavitzkyGolay(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	// The sliding moments accumulate rounding errors in the values, so they are summed anew every so often. That costs O(n * w / RECOMPUTE_INTERVAL).
+	static constexpr std::size_t RECOMPUTE_INTERVAL = 1024;
+
+	std::size_t const size = input.size();
+	// Even window sizes are rounded up, the fit needs a center sample
+	std::size_t const half = windowSize / 2;
+	auto const isValid = [cutoffMin, cutoffMax](double value) {
+		return value >= cutoffMin && value <= cutoffMax;
+	};
+	auto const offset = [](std::size_t j, std::size_t center) {
+		return static_cast<std::int64_t>(j) - static_cast<std::int64_t>(center);
+	};
+
+	if (half == 0) {
+		for (std::size_t i = 0; i < size; ++i) {
+			output[i] = isValid(input[i]) ? input[i] : MISSING_VALUE;
+		}
+		return;
+	}
+
+	WindowMoments moments;
+	for (std::size_t i = 0; i < size; ++i) {
+		if (i % RECOMPUTE_INTERVAL == 0) {
+			moments = WindowMoments();
+			for (std::size_t j = (i > half) ? (i - half) : 0; j <= std::min(i + half, size - 1); ++j) {
+				if (isValid(input[j])) moments.Add(offset(j, i), input[j]);
+			}
+		}
+		output[i] = moments.EvaluateFit(half, isValid(input[i]));
+
+		if ((i + 1) % RECOMPUTE_INTERVAL != 0 && i + 1 < size) {
+			// Window of i + 1 is the window of i without i - half, plus i + 1 + half
+			if (i >= half && isValid(input[i - half])) moments.Remove(offset(i - half, i), input[i - half]);
+			moments.Shift();
+			if (i + 1 + half < size && isValid(input[i + 1 + half])) moments.Add(offset(i + 1 + half, i + 1), input[i + 1 + half]);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "SeriesOptions.hpp"
+
+char const* GetFilterTypeName(FilterType filterType);
+
+// Smooths a series as selected by SeriesOptions::filterType, see FilterType.
+// Values outside of [cutoffMin, cutoffMax] (and NaN) are treated as missing: they do not contribute, and output[i] is NaN if no value
+// the filter would use for it is valid. The window size is in samples, every filter is the identity on the valid values for a window size of 1.
+// All filters take O(n) time, the median O(n log w). The buffers are kept between calls, so filtering does not allocate once they grew.
+class SeriesFilter {
+public:
+	// input and output have to be of the same size and may not overlap.
+	void Apply(std::span<double const> input, SeriesOptions const& options, std::span<double> output);
+private:
+	struct HeapEntry {
+		double value;
+		std::size_t id;
+	};
+
+	// Gaussian: weighted values and weights, each with a second buffer to ping-pong between the passes
+	std::vector<double> m_values;
+	std::vector<double> m_weights;
+	std::vector<double> m_valuesScratch;
+	std::vector<double> m_weightsScratch;
+
+	// Median: the lower half of the window as max heap, the upper half as min heap, and where each sample of the window is in them
+	std::vector<HeapEntry> m_lowerHeap;
+	std::vector<HeapEntry> m_upperHeap;
+	std::vector<std::size_t> m_heapPositions;
+
+	void applyExponential(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output);
+	void applyGaussian(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output);
+	void applyMedian(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output);
+	void applySavitzkyGolay(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output);
+};
@@ -0,0 +1,380 @@
+#include "SeriesKernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+void MovingAverage(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	std::size_t const size = input.size();
+	if (size == 0) return;
+	if (windowSize == 0) {
+		std::fill(output.begin(), output.end(), MISSING_VALUE);
+		return;
+	}
+
+	auto const isValid = [cutoffMin, cutoffMax](double value) {
+		return value >= cutoffMin && value <= cutoffMax;
+	};
+
+	// Running sum over the window of index 0, with the clamped tail counted as repetitions of the last element
+	double sum = 0.0;
+	std::size_t summands = 0;
+	for (std::size_t j = 0; j < std::min(windowSize, size); ++j) {
+		if (isValid(input[j])) {
+			sum += input[j];
+			++summands;
+		}
+	}
+	if (windowSize > size && isValid(input[size - 1])) {
+		sum += input[size - 1] * static_cast<double>(windowSize - size);
+		summands += windowSize - size;
+	}
+
+	for (std::size_t i = 0; i < size; ++i) {
+		output[i] = (summands > 0) ? (sum / static_cast<double>(summands)) : MISSING_VALUE;
+
+		// Window of i + 1 is the window of i without input[i], plus input[min(i + windowSize, size - 1)]
+		if (isValid(input[i])) {
+			sum -= input[i];
+			--summands;
+		}
+		double const incoming = input[std::min(i + windowSize, size - 1)];
+		if (isValid(incoming)) {
+			sum += incoming;
+			++summands;
+		}
+		if (summands == 0) {
+			// Do not carry rounding errors over gaps
+			sum = 0.0;
+		}
+	}
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SERIES_KERNELS_HAVE_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC compiles intrinsics of any instruction set without special flags
+#define SERIES_KERNELS_TARGET_AVX2
+#else
+#define SERIES_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static KernelInstructionSet DetectBestKernelInstructionSet() {
+#ifdef SERIES_KERNELS_HAVE_AVX2
+#ifdef _MSC_VER
+	int registers[4];
+	__cpuid(registers, 0);
+	if (registers[0] < 7) return KernelInstructionSet::Scalar;
+	__cpuid(registers, 1);
+	bool const hasOsAvxSupport = (registers[2] & (1 << 27)) != 0 && (registers[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(registers, 7, 0);
+	if (hasOsAvxSupport && (registers[1] & (1 << 5)) != 0) return KernelInstructionSet::Avx2;
+#else
+	// Also checks whether the OS saves the AVX registers
+	if (__builtin_cpu_supports("avx2")) return KernelInstructionSet::Avx2;
+#endif
+#endif
+	return KernelInstructionSet::Scalar;
+}
+
+KernelInstructionSet GetBestKernelInstructionSet() {
+	static KernelInstructionSet const best = DetectBestKernelInstructionSet();
+	return best;
+}
+
+static std::atomic<KernelInstructionSet>& GetActiveInstructionSet() {
+	static std::atomic<KernelInstructionSet> active = GetBestKernelInstructionSet();
+	return active;
+}
+
+KernelInstructionSet GetKernelInstructionSet() {
+	return GetActiveInstructionSet().load(std::memory_order_relaxed);
+}
+
+void SetKernelInstructionSet(KernelInstructionSet instructionSet) {
+	if (instructionSet > GetBestKernelInstructionSet()) {
+		instructionSet = KernelInstructionSet::Scalar;
+	}
+	GetActiveInstructionSet().store(instructionSet, std::memory_order_relaxed);
+}
+
+char const* GetKernelInstructionSetName(KernelInstructionSet instructionSet) {
+	switch (instructionSet) {
+		case KernelInstructionSet::Avx2:
+			return "AVX2";
+		default:
+			return "Scalar";
+	}
+}
+
+// The 64 validity bits starting at index, bits past the end are 0
+static inline std::uint64_t GetValidityBits(std::span<std::uint64_t const> validity, std::size_t index) {
+	std::size_t const word = index / 64;
+	std::size_t const bit = index % 64;
+	if (word >= validity.size()) return 0;
+	std::uint64_t result = validity[word] >> bit;
+	if (bit > 0 && (word + 1) < validity.size()) result |= validity[word + 1] << (64 - bit);
+	return result;
+}
+
+static inline double ComputeSpeedScalar(std::int64_t timePassedMs, double distanceTravelledMeters, bool isValid, double minSpeedMetersPerSecond) {
+	double const speed = distanceTravelledMeters / (static_cast<double>(timePassedMs) / 1000.0);
+	return (isValid && timePassedMs > 0 && speed > minSpeedMetersPerSecond) ? speed : MISSING_VALUE;
+}
+
+static constexpr double EARTH_RADIUS_METERS = 6371008.8;
+static constexpr double RADIANS_PER_DEGREE = 3.14159265358979323846 / 180.0;
+// Up to this difference in latitude and longitude (in radians, about 64 km) the series below are exact to the last bit or so. Consecutive samples
+// are nearly always closer, farther ones use the exact functions of the standard library.
+static constexpr double MAX_SERIES_ANGLE = 0.01;
+// Taylor series of sin(x) for |x| <= MAX_SERIES_ANGLE / 2, of asin(y) for the y that results from that, and of cos(x) for |x| <= pi / 2
+static constexpr double SIN_COEFFICIENTS[] = { -1.0 / 6.0, 1.0 / 120.0, -1.0 / 5040.0 };
+static constexpr double ASIN_COEFFICIENTS[] = { 1.0 / 6.0, 3.0 / 40.0, 5.0 / 112.0, 35.0 / 1152.0 };
+static constexpr double COS_COEFFICIENTS[] = { -1.0 / 2.0, 1.0 / 24.0, -1.0 / 720.0, 1.0 / 40320.0, -1.0 / 3628800.0, 1.0 / 479001600.0,
+	-1.0 / 87178291200.0, 1.0 / 20922789888000.0, -1.0 / 6402373705728000.0, 1.0 / 2432902008176640000.0 };
+
+// 1 + c[0] * x2 + c[1] * x2^2 + ..., by Horner's method
+template<std::size_t N>
+static inline double EvaluateSeries(double const (&coefficients)[N], double x2) {
+	double result = coefficients[N - 1];
+	for (std::size_t k = N - 1; k > 0; --k) {
+		result = coefficients[k - 1] + x2 * result;
+	}
+	return 1.0 + x2 * result;
+}
+
+static double HaversineMetersExact(double latitude1, double latitude2, double latitudeDelta, double longitudeDelta) {
+	double const sinLatitude = std::sin(latitudeDelta * 0.5);
+	double const sinLongitude = std::sin(longitudeDelta * 0.5);
+	double const a = std::min(1.0, sinLatitude * sinLatitude + (std::cos(latitude1) * std::cos(latitude2)) * (sinLongitude * sinLongitude));
+	return (2.0 * EARTH_RADIUS_METERS) * std::asin(std::sqrt(a));
+}
+
+static inline double HaversineMetersScalar(double latitude1Degrees, double longitude1Degrees, double latitude2Degrees, double longitude2Degrees) {
+	double const latitude1 = latitude1Degrees * RADIANS_PER_DEGREE;
+	double const latitude2 = latitude2Degrees * RADIANS_PER_DEGREE;
+	double const latitudeDelta = (latitude2Degrees - latitude1Degrees) * RADIANS_PER_DEGREE;
+	double const longitudeDelta = (longitude2Degrees - longitude1Degrees) * RADIANS_PER_DEGREE;
+	if (!(std::abs(latitudeDelta) <= MAX_SERIES_ANGLE) || !(std::abs(longitudeDelta) <= MAX_SERIES_ANGLE)) {
+		return HaversineMetersExact(latitude1, latitude2, latitudeDelta, longitudeDelta);
+	}
+
+	double const halfLatitudeDelta = latitudeDelta * 0.5;
+	double const halfLongitudeDelta = longitudeDelta * 0.5;
+	double const sinLatitude = halfLatitudeDelta * EvaluateSeries(SIN_COEFFICIENTS, halfLatitudeDelta * halfLatitudeDelta);
+	double const sinLongitude = halfLongitudeDelta * EvaluateSeries(SIN_COEFFICIENTS, halfLongitudeDelta * halfLongitudeDelta);
+	double const cosLatitudes = EvaluateSeries(COS_COEFFICIENTS, latitude1 * latitude1) * EvaluateSeries(COS_COEFFICIENTS, latitude2 * latitude2);
+	double const y = std::sqrt(sinLatitude * sinLatitude + cosLatitudes * (sinLongitude * sinLongitude));
+	return (2.0 * EARTH_RADIUS_METERS) * (y * EvaluateSeries(ASIN_COEFFICIENTS, y * y));
+}
+
+static inline double SpeedToPaceScalar(double metersPerSecond) {
+	return (std::abs(metersPerSecond) <= 0.01) ? MISSING_VALUE : (1.0 / (metersPerSecond * 3.6 / 60.0));
+}
+
+#ifdef SERIES_KERNELS_HAVE_AVX2
+// Lane k is all ones if bit k of bits is set
+SERIES_KERNELS_TARGET_AVX2 static inline __m256d GetLaneMask(std::uint64_t bits) {
+	__m256i const laneBits = _mm256_setr_epi64x(1, 2, 4, 8);
+	return _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(static_cast<long long>(bits & 0xF)), laneBits), laneBits));
+}
+
+SERIES_KERNELS_TARGET_AVX2 static std::size_t ComputeSpeedAvx2(std::span<std::int64_t const> timeMs, std::span<double const> distanceMeters, std::span<std::uint64_t const> distanceValidity, double minSpeedMetersPerSecond, std::span<double> speed) {
+	// AVX2 can not convert int64 to double. Time differences are far below 2^52, so putting them into the mantissa of 2^52 and subtracting it does.
+	__m256i const magicBits = _mm256_set1_epi64x(0x4330000000000000ll);
+	__m256d const magic = _mm256_set1_pd(4503599627370496.0);
+	__m256d const thousand = _mm256_set1_pd(1000.0);
+	__m256d const minSpeed = _mm256_set1_pd(minSpeedMetersPerSecond);
+	__m256d const missing = _mm256_set1_pd(MISSING_VALUE);
+	__m256i const zero = _mm256_setzero_si256();
+
+	std::size_t i = 0;
+	for (; (i + 4) < timeMs.size(); i += 4) {
+		__m256i const timePassedMs = _mm256_sub_epi64(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(timeMs.data() + i + 1)), _mm256_loadu_si256(reinterpret_cast<__m256i const*>(timeMs.data() + i)));
+		__m256d const isIncreasing = _mm256_castsi256_pd(_mm256_cmpgt_epi64(timePassedMs, zero));
+		__m256d const seconds = _mm256_div_pd(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(timePassedMs, magicBits)), magic), thousand);
+		__m256d const distance = _mm256_sub_pd(_mm256_loadu_pd(distanceMeters.data() + i + 1), _mm256_loadu_pd(distanceMeters.data() + i));
+		__m256d const value = _mm256_div_pd(distance, seconds);
+
+		std::uint64_t const bits = GetValidityBits(distanceValidity, i);
+		__m256d const isValid = _mm256_and_pd(_mm256_and_pd(GetLaneMask(bits & (bits >> 1)), isIncreasing), _mm256_cmp_pd(value, minSpeed, _CMP_GT_OQ));
+		_mm256_storeu_pd(speed.data() + i, _mm256_blendv_pd(missing, value, isValid));
+	}
+	return i;
+}
+
+template<std::size_t N>
+SERIES_KERNELS_TARGET_AVX2 static inline __m256d EvaluateSeriesAvx2(double const (&coefficients)[N], __m256d x2) {
+	__m256d result = _mm256_set1_pd(coefficients[N - 1]);
+	for (std::size_t k = N - 1; k > 0; --k) {
+		result = _mm256_add_pd(_mm256_set1_pd(coefficients[k - 1]), _mm256_mul_pd(x2, result));
+	}
+	return _mm256_add_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(x2, result));
+}
+
+SERIES_KERNELS_TARGET_AVX2 static std::size_t ComputePositionSpeedAvx2(std::span<std::int64_t const> timeMs, std::span<double const> latitudeDegrees, std::span<double const> longitudeDegrees, std::span<std::uint64_t const> positionValidity, double minSpeedMetersPerSecond, std::span<double> speed) {
+	// See ComputeSpeedAvx2() for the time conversion
+	__m256i const magicBits = _mm256_set1_epi64x(0x4330000000000000ll);
+	__m256d const magic = _mm256_set1_pd(4503599627370496.0);
+	__m256d const thousand = _mm256_set1_pd(1000.0);
+	__m256d const minSpeed = _mm256_set1_pd(minSpeedMetersPerSecond);
+	__m256d const missing = _mm256_set1_pd(MISSING_VALUE);
+	__m256i const zero = _mm256_setzero_si256();
+	__m256d const absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+	__m256d const radiansPerDegree = _mm256_set1_pd(RADIANS_PER_DEGREE);
+	__m256d const maxSeriesAngle = _mm256_set1_pd(MAX_SERIES_ANGLE);
+	__m256d const half = _mm256_set1_pd(0.5);
+	__m256d const diameter = _mm256_set1_pd(2.0 * EARTH_RADIUS_METERS);
+
+	std::size_t i = 0;
+	for (; (i + 4) < timeMs.size(); i += 4) {
+		__m256d const latitude1Degrees = _mm256_loadu_pd(latitudeDegrees.data() + i);
+		__m256d const latitude2Degrees = _mm256_loadu_pd(latitudeDegrees.data() + i + 1);
+		__m256d const latitude1 = _mm256_mul_pd(latitude1Degrees, radiansPerDegree);
+		__m256d const latitude2 = _mm256_mul_pd(latitude2Degrees, radiansPerDegree);
+		__m256d const latitudeDelta = _mm256_mul_pd(_mm256_sub_pd(latitude2Degrees, latitude1Degrees), radiansPerDegree);
+		__m256d const longitudeDelta = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(longitudeDegrees.data() + i + 1), _mm256_loadu_pd(longitudeDegrees.data() + i)), radiansPerDegree);
+		__m256d const isSmall = _mm256_and_pd(_mm256_cmp_pd(_mm256_and_pd(latitudeDelta, absMask), maxSeriesAngle, _CMP_LE_OQ), _mm256_cmp_pd(_mm256_and_pd(longitudeDelta, absMask), maxSeriesAngle, _CMP_LE_OQ));
+
+		__m256d const halfLatitudeDelta = _mm256_mul_pd(latitudeDelta, half);
+		__m256d const halfLongitudeDelta = _mm256_mul_pd(longitudeDelta, half);
+		__m256d const sinLatitude = _mm256_mul_pd(halfLatitudeDelta, EvaluateSeriesAvx2(SIN_COEFFICIENTS, _mm256_mul_pd(halfLatitudeDelta, halfLatitudeDelta)));
+		__m256d const sinLongitude = _mm256_mul_pd(halfLongitudeDelta, EvaluateSeriesAvx2(SIN_COEFFICIENTS, _mm256_mul_pd(halfLongitudeDelta, halfLongitudeDelta)));
+		__m256d const cosLatitudes = _mm256_mul_pd(EvaluateSeriesAvx2(COS_COEFFICIENTS, _mm256_mul_pd(latitude1, latitude1)), EvaluateSeriesAvx2(COS_COEFFICIENTS, _mm256_mul_pd(latitude2, latitude2)));
+		__m256d const y = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(sinLatitude, sinLatitude), _mm256_mul_pd(cosLatitudes, _mm256_mul_pd(sinLongitude, sinLongitude))));
+		__m256d distance = _mm256_mul_pd(diameter, _mm256_mul_pd(y, EvaluateSeriesAvx2(ASIN_COEFFICIENTS, _mm256_mul_pd(y, y))));
+
+		int const smallLanes = _mm256_movemask_pd(isSmall);
+		if (smallLanes != 0xF) {
+			// Rare, e.g. after a GPS reset, so just redo those lanes like the scalar variant
+			alignas(32) double distances[4];
+			_mm256_store_pd(distances, distance);
+			for (std::size_t k = 0; k < 4; ++k) {
+				if ((smallLanes & (1 << k)) == 0) {
+					distances[k] = HaversineMetersScalar(latitudeDegrees[i + k], longitudeDegrees[i + k], latitudeDegrees[i + k + 1], longitudeDegrees[i + k + 1]);
+				}
+			}
+			distance = _mm256_load_pd(distances);
+		}
+
+		__m256i const timePassedMs = _mm256_sub_epi64(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(timeMs.data() + i + 1)), _mm256_loadu_si256(reinterpret_cast<__m256i const*>(timeMs.data() + i)));
+		__m256d const isIncreasing = _mm256_castsi256_pd(_mm256_cmpgt_epi64(timePassedMs, zero));
+		__m256d const seconds = _mm256_div_pd(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(timePassedMs, magicBits)), magic), thousand);
+		__m256d const value = _mm256_div_pd(distance, seconds);
+
+		std::uint64_t const bits = GetValidityBits(positionValidity, i);
+		__m256d const isValid = _mm256_and_pd(_mm256_and_pd(GetLaneMask(bits & (bits >> 1)), isIncreasing), _mm256_cmp_pd(value, minSpeed, _CMP_GT_OQ));
+		_mm256_storeu_pd(speed.data() + i, _mm256_blendv_pd(missing, value, isValid));
+	}
+	return i;
+}
+
+SERIES_KERNELS_TARGET_AVX2 static std::size_t ScaleAvx2(std::span<double const> input, double factor, std::span<double> output) {
+	__m256d const factors = _mm256_set1_pd(factor);
+	std::size_t i = 0;
+	for (; (i + 4) <= input.size(); i += 4) {
+		_mm256_storeu_pd(output.data() + i, _mm256_mul_pd(_mm256_loadu_pd(input.data() + i), factors));
+	}
+	return i;
+}
+
+SERIES_KERNELS_TARGET_AVX2 static std::size_t SpeedToPaceAvx2(std::span<double const> metersPerSecond, std::span<double> paceMinutesPerKilometer) {
+	__m256d const absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+	__m256d const standing = _mm256_set1_pd(0.01);
+	__m256d const toKilometersPerHour = _mm256_set1_pd(3.6);
+	__m256d const minutesPerHour = _mm256_set1_pd(60.0);
+	__m256d const one = _mm256_set1_pd(1.0);
+	__m256d const missing = _mm256_set1_pd(MISSING_VALUE);
+	std::size_t i = 0;
+	for (; (i + 4) <= metersPerSecond.size(); i += 4) {
+		__m256d const speed = _mm256_loadu_pd(metersPerSecond.data() + i);
+		__m256d const pace = _mm256_div_pd(one, _mm256_div_pd(_mm256_mul_pd(speed, toKilometersPerHour), minutesPerHour));
+		__m256d const isStanding = _mm256_cmp_pd(_mm256_and_pd(speed, absMask), standing, _CMP_LE_OQ);
+		_mm256_storeu_pd(paceMinutesPerKilometer.data() + i, _mm256_blendv_pd(pace, missing, isStanding));
+	}
+	return i;
+}
+
+SERIES_KERNELS_TARGET_AVX2 static std::size_t ValidBytesToDoubleAvx2(std::span<std::uint8_t const> values, std::span<std::uint64_t const> validity, std::span<double> output) {
+	__m256d const missing = _mm256_set1_pd(MISSING_VALUE);
+	std::size_t i = 0;
+	for (; (i + 4) <= values.size(); i += 4) {
+		std::int32_t packed;
+		std::memcpy(&packed, values.data() + i, sizeof(packed));
+		__m256d const value = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+		_mm256_storeu_pd(output.data() + i, _mm256_blendv_pd(missing, value, GetLaneMask(GetValidityBits(validity, i))));
+	}
+	return i;
+}
+#endif
+
+void ComputeSpeedKernel(std::span<std::int64_t const> timeMs, std::span<double const> distanceMeters, std::span<std::uint64_t const> distanceValidity, double minSpeedMetersPerSecond, std::span<double> speed) {
+	std::size_t i = 0;
+#ifdef SERIES_KERNELS_HAVE_AVX2
+	if (GetKernelInstructionSet() == KernelInstructionSet::Avx2) {
+		i = ComputeSpeedAvx2(timeMs, distanceMeters, distanceValidity, minSpeedMetersPerSecond, speed);
+	}
+#endif
+	for (; (i + 1) < timeMs.size(); ++i) {
+		bool const isValid = ((distanceValidity[i / 64] >> (i % 64)) & (distanceValidity[(i + 1) / 64] >> ((i + 1) % 64)) & 1u) != 0;
+		speed[i] = ComputeSpeedScalar(timeMs[i + 1] - timeMs[i], distanceMeters[i + 1] - distanceMeters[i], isValid, minSpeedMetersPerSecond);
+	}
+}
+
+void ComputePositionSpeedKernel(std::span<std::int64_t const> timeMs, std::span<double const> latitudeDegrees, std::span<double const> longitudeDegrees, std::span<std::uint64_t const> positionValidity, double minSpeedMetersPerSecond, std::span<double> speed) {
+	std::size_t i = 0;
+#ifdef SERIES_KERNELS_HAVE_AVX2
+	if (GetKernelInstructionSet() == KernelInstructionSet::Avx2) {
+		i = ComputePositionSpeedAvx2(timeMs, latitudeDegrees, longitudeDegrees, positionValidity, minSpeedMetersPerSecond, speed);
+	}
+#endif
+	for (; (i + 1) < timeMs.size(); ++i) {
+		bool const isValid = ((positionValidity[i / 64] >> (i % 64)) & (positionValidity[(i + 1) / 64] >> ((i + 1) % 64)) & 1u) != 0;
+		double const distanceMeters = HaversineMetersScalar(latitudeDegrees[i], longitudeDegrees[i], latitudeDegrees[i + 1], longitudeDegrees[i + 1]);
+		speed[i] = ComputeSpeedScalar(timeMs[i + 1] - timeMs[i], distanceMeters, isValid, minSpeedMetersPerSecond);
+	}
+}
+
+double HaversineMeters(double latitude1Degrees, double longitude1Degrees, double latitude2Degrees, double longitude2Degrees) {
+	return HaversineMetersScalar(latitude1Degrees, longitude1Degrees, latitude2Degrees, longitude2Degrees);
+}
+
+void ScaleKernel(std::span<double const> input, double factor, std::span<double> output) {
+	std::size_t i = 0;
+#ifdef SERIES_KERNELS_HAVE_AVX2
+	if (GetKernelInstructionSet() == KernelInstructionSet::Avx2) {
+		i = ScaleAvx2(input, factor, output);
+	}
+#endif
+	for (; i < input.size(); ++i) {
+		output[i] = input[i] * factor;
+	}
+}
+
+void SpeedToPaceKernel(std::span<double const> metersPerSecond, std::span<double> paceMinutesPerKilometer) {
+	std::size_t i = 0;
+#ifdef SERIES_KERNELS_HAVE_AVX2
+	if (GetKernelInstructionSet() == KernelInstructionSet::Avx2) {
+		i = SpeedToPaceAvx2(metersPerSecond, paceMinutesPerKilometer);
+	}
+#endif
+	for (; i < metersPerSecond.size(); ++i) {
+		paceMinutesPerKilometer[i] = SpeedToPaceScalar(metersPerSecond[i]);
+	}
+}
+
+void ValidBytesToDoubleKernel(std::span<std::uint8_t const> values, std::span<std::uint64_t const> validity, std::span<double> output) {
+	std::size_t i = 0;
+#ifdef SERIES_KERNELS_HAVE_AVX2
+	if (GetKernelInstructionSet() == KernelInstructionSet::Avx2) {
+		i = ValidBytesToDoubleAvx2(values, validity, output);
+	}
+#endif
+	for (; i < values.size(); ++i) {
+		output[i] = ((validity[i / 64] >> (i % 64)) & 1u) ? static_cast<double>(values[i]) : MISSING_VALUE;
+	}
+}
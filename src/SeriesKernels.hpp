@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+// Kernels working on whole series of values. Missing values are represented as NaN.
+
+static constexpr double MISSING_VALUE = std::numeric_limits<double>::quiet_NaN();
+
+// The window used for the "Window Size" option: output[i] is the mean of the valid values among input[i], ..., input[i + windowSize - 1],
+// where indices past the end are clamped to the last element. A value is valid if it is in [cutoffMin, cutoffMax] (so NaN never is).
+// If no value in the window is valid, output[i] is NaN. Runs in O(n) independent of the window size.
+// input and output have to be of the same size and may not overlap.
+void MovingAverage(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output);
+
+// The element-wise kernels below exist in several variants, the best one the CPU supports is picked at runtime.
+// All variants give bit-identical results, as long as the compiler does not contract multiplies and adds into FMAs (CMakeLists.txt turns that off
+// for SeriesKernels.cpp). The scalar one is written so that compilers can auto-vectorize it (e.g. to SSE2 on x86-64).
+enum class KernelInstructionSet {
+	Scalar = 0,
+	Avx2
+};
+
+KernelInstructionSet GetBestKernelInstructionSet();
+KernelInstructionSet GetKernelInstructionSet();
+// Switches all kernels to the given variant, e.g. for comparing them. Falls back to the scalar one if the CPU does not support it.
+void SetKernelInstructionSet(KernelInstructionSet instructionSet);
+char const* GetKernelInstructionSetName(KernelInstructionSet instructionSet);
+
+// speed[i] is the speed in m/s between sample i and i + 1, i.e. (distanceMeters[i + 1] - distanceMeters[i]) / seconds passed.
+// It is NaN if the distance of one of the samples is invalid (per bit of distanceValidity, as in ValidityMask::GetWords()),
+// if the time does not strictly increase, or if the speed is not above minSpeedMetersPerSecond.
+// timeMs and distanceMeters have to be of the same size n, speed has to hold n - 1 values.
+void ComputeSpeedKernel(std::span<std::int64_t const> timeMs, std::span<double const> distanceMeters, std::span<std::uint64_t const> distanceValidity, double minSpeedMetersPerSecond, std::span<double> speed);
+
+// Like ComputeSpeedKernel(), but the distance is the great circle distance between the positions of sample i and i + 1 (haversine formula,
+// on a sphere of the mean earth radius). Positions are invalid per bit of positionValidity. All arrays have to be of the same size n.
+void ComputePositionSpeedKernel(std::span<std::int64_t const> timeMs, std::span<double const> latitudeDegrees, std::span<double const> longitudeDegrees, std::span<std::uint64_t const> positionValidity, double minSpeedMetersPerSecond, std::span<double> speed);
+
+// The great circle distance between two positions, the same as ComputePositionSpeedKernel() uses for a step.
+double HaversineMeters(double latitude1Degrees, double longitude1Degrees, double latitude2Degrees, double longitude2Degrees);
+
+// output[i] = input[i] * factor, e.g. for converting m/s into km/h. NaN stays NaN.
+void ScaleKernel(std::span<double const> input, double factor, std::span<double> output);
+
+// Pace in min/km of a speed in m/s. NaN stays NaN, and speeds of 0.01 m/s and below (standing still) have no meaningful pace and are NaN.
+void SpeedToPaceKernel(std::span<double const> metersPerSecond, std::span<double> paceMinutesPerKilometer);
+
+// output[i] = values[i] where the bit i of validity is set, NaN otherwise. output has to be of the same size as values.
+void ValidBytesToDoubleKernel(std::span<std::uint8_t const> values, std::span<std::uint64_t const> validity, std::span<double> output);
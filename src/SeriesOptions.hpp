@@ -0,0 +1,32 @@
+#pragma once
+
+// How a series is smoothed, see SeriesFilter::Apply(). The values are the indices in the filter combo box of DataOptions.
+enum class FilterType : int {
+	// Mean of the window starting at each sample
+	MovingAverage = 0,
+	// Exponential moving average over the past, smoothing factor 2 / (window size + 1)
+	Exponential,
+	// Gaussian centered on each sample, the window spans +-3 standard deviations
+	Gaussian,
+	// Median of the window centered on each sample
+	Median,
+	// Quadratic least squares fit over the window centered on each sample
+	SavitzkyGolay,
+	COUNT
+};
+
+// How a derived series is smoothed and whether it is shown. Edited through DataOptions, but free of Qt so the analysis code can use it anywhere.
+struct SeriesOptions {
+	bool show;
+	FilterType filterType;
+	int windowSize;
+	double cutoffMin;
+	double cutoffMax;
+
+	SeriesOptions() : show(false), filterType(FilterType::MovingAverage), windowSize(1), cutoffMin(0.0), cutoffMax(999.0) {}
+
+	// True if both options lead to the same values, i.e. they only differ in whether the series is shown.
+	inline bool HasSameComputation(SeriesOptions const& other) const {
+		return filterType == other.filterType && windowSize == other.windowSize && cutoffMin == other.cutoffMin && cutoffMax == other.cutoffMax;
+	}
+};
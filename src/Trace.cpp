@@ -0,0 +1,111 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+	// Events are coarse (one per stage, not per trackpoint), so a single lock is cheap enough
+	std::mutex s_mutex;
+	std::vector<Trace::Event> s_events;
+	// Where the next event goes once s_events is full
+	std::size_t s_nextEvent = 0;
+	std::vector<std::pair<char const*, std::int64_t>> s_latestDurations;
+
+	std::atomic<std::uint32_t> s_threadCount = 0;
+
+	std::uint32_t GetThreadId() {
+		thread_local std::uint32_t const threadId = ++s_threadCount;
+		return threadId;
+	}
+}
+
+void Trace::SetEnabled(bool isEnabled) {
+	s_isEnabled.store(isEnabled, std::memory_order_relaxed);
+}
+
+std::int64_t Trace::Now() {
+	static auto const epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::Record(char const* name, std::int64_t startNs, std::int64_t durationNs) {
+	Event const event{ name, GetThreadId(), startNs, durationNs };
+	std::lock_guard<std::mutex> const lock(s_mutex);
+	if (s_events.size() < MAX_EVENTS) {
+		s_events.push_back(event);
+	}
+	else {
+		s_events[s_nextEvent] = event;
+		s_nextEvent = (s_nextEvent + 1) % MAX_EVENTS;
+	}
+
+	// The same literal may have different addresses in different translation units
+	for (auto& latest : s_latestDurations) {
+		if (latest.first == name || std::strcmp(latest.first, name) == 0) {
+			latest.second = durationNs;
+			return;
+		}
+	}
+	s_latestDurations.emplace_back(name, durationNs);
+}
+
+void Trace::Clear() {
+	std::lock_guard<std::mutex> const lock(s_mutex);
+	s_events.clear();
+	s_nextEvent = 0;
+	s_latestDurations.clear();
+}
+
+std::vector<Trace::Event> Trace::GetEvents() {
+	std::lock_guard<std::mutex> const lock(s_mutex);
+	std::vector<Event> result;
+	result.reserve(s_events.size());
+	result.insert(result.end(), s_events.begin() + static_cast<std::ptrdiff_t>(s_nextEvent), s_events.end());
+	result.insert(result.end(), s_events.begin(), s_events.begin() + static_cast<std::ptrdiff_t>(s_nextEvent));
+	return result;
+}
+
+std::vector<std::pair<char const*, double>> Trace::GetLatestDurationsMs() {
+	std::lock_guard<std::mutex> const lock(s_mutex);
+	std::vector<std::pair<char const*, double>> result;
+	result.reserve(s_latestDurations.size());
+	for (auto const& [name, durationNs] : s_latestDurations) {
+		result.emplace_back(name, static_cast<double>(durationNs) / 1e6);
+	}
+	return result;
+}
+
+void Trace::WriteChromeJson(std::ostream& out) {
+	auto const events = GetEvents();
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	char buffer[64];
+	for (std::size_t i = 0; i < events.size(); ++i) {
+		Event const& event = events[i];
+		out << ((i > 0) ? ",\n" : "\n") << "{\"name\":\"";
+		for (char const* c = event.name; *c != '\0'; ++c) {
+			if (*c == '"' || *c == '\\') out << '\\';
+			out << *c;
+		}
+		// Chrome expects microseconds
+		std::snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(event.startNs) / 1000.0);
+		out << "\",\"cat\":\"TcxViewer\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId << ",\"ts\":" << buffer;
+		std::snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(event.durationNs) / 1000.0);
+		out << ",\"dur\":" << buffer << "}";
+	}
+	out << "\n]}\n";
+}
+
+void Trace::WriteChromeJson(std::filesystem::path const& file) {
+	std::ofstream out(file, std::ios::binary);
+	if (!out) {
+		throw std::runtime_error("Failed to open '" + file.string() + "' for writing!");
+	}
+	WriteChromeJson(out);
+	if (!out) {
+		throw std::runtime_error("Failed to write '" + file.string() + "'!");
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// Lightweight instrumentation of the hot paths: TRACE_SCOPE("Name") at the start of a block records how long the block took.
+// Recording is off by default, then a scope costs a single relaxed atomic load. When on, the spans of all threads are collected
+// (the latest MAX_EVENTS of them) and can be written as Chrome trace JSON, to be opened in chrome://tracing or Perfetto.
+class Trace {
+public:
+	static constexpr std::size_t MAX_EVENTS = std::size_t(1) << 16;
+
+	struct Event {
+		// Has to be a string literal, only the pointer is kept
+		char const* name;
+		std::uint32_t threadId;
+		// Nanoseconds since the first use of the trace clock
+		std::int64_t startNs;
+		std::int64_t durationNs;
+	};
+
+	static void SetEnabled(bool isEnabled);
+	static inline bool IsEnabled() {
+		return s_isEnabled.load(std::memory_order_relaxed);
+	}
+
+	static std::int64_t Now();
+	static void Record(char const* name, std::int64_t startNs, std::int64_t durationNs);
+	// Removes all recorded events.
+	static void Clear();
+
+	// All recorded events, oldest first.
+	static std::vector<Event> GetEvents();
+	// Duration in ms of the latest event of every name, in the order the names were first recorded.
+	static std::vector<std::pair<char const*, double>> GetLatestDurationsMs();
+
+	static void WriteChromeJson(std::ostream& out);
+	// Throws std::runtime_error if the file can not be written.
+	static void WriteChromeJson(std::filesystem::path const& file);
+private:
+	static inline std::atomic<bool> s_isEnabled = false;
+};
+
+// Records the time from its construction to its destruction, if tracing was enabled at its construction.
+class ScopedTrace {
+public:
+	explicit ScopedTrace(char const* name) : m_name(name), m_startNs(Trace::IsEnabled() ? Trace::Now() : -1) {}
+	~ScopedTrace() {
+		if (m_startNs >= 0) {
+			Trace::Record(m_name, m_startNs, Trace::Now() - m_startNs);
+		}
+	}
+
+	ScopedTrace(ScopedTrace const&) = delete;
+	ScopedTrace& operator=(ScopedTrace const&) = delete;
+private:
+	char const* const m_name;
+	std::int64_t const m_startNs;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) ScopedTrace const TRACE_CONCAT(traceScope, __LINE__)(name)
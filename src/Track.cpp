@@ -0,0 +1,142 @@
+#include "Track.hpp"
+
+#include <limits>
+
+char const* GetSportName(Sport sport) {
+	switch (sport) {
+		case Sport::Running:
+			return "Running";
+		case Sport::Biking:
+			return "Biking";
+		default:
+			return "Other";
+	}
+}
+
+Sport GetSportByName(std::string_view name) {
+	if (name == "Running") return Sport::Running;
+	if (name == "Biking") return Sport::Biking;
+	return Sport::Other;
+}
+
+void Track::Reserve(std::size_t size) {
+	m_timeMs.reserve(size);
+	m_latitudeDegrees.reserve(size);
+	m_longitudeDegrees.reserve(size);
+	m_altitudeMeters.reserve(size);
+	m_distanceMeters.reserve(size);
+	m_heartRateBpm.reserve(size);
+	m_cadenceRpm.reserve(size);
+	m_powerWatts.reserve(size);
+	m_hasPosition.Reserve(size);
+	m_hasAltitude.Reserve(size);
+	m_hasDistance.Reserve(size);
+	m_hasHeartRate.Reserve(size);
+	m_hasCadence.Reserve(size);
+	m_hasPower.Reserve(size);
+}
+
+void Track::Append(Trackpoint const& tp) {
+	bool const hasPosition = tp.HasPosition();
+	bool const hasAltitude = tp.HasAltitude();
+	bool const hasDistance = tp.HasDistance();
+	bool const hasHeartRate = tp.HasHeartRate() && tp.heartRateBpm >= 0 && tp.heartRateBpm <= std::numeric_limits<std::uint8_t>::max();
+	bool const hasCadence = tp.HasCadence() && tp.cadenceRpm >= 0 && tp.cadenceRpm <= std::numeric_limits<std::uint8_t>::max();
+	bool const hasPower = tp.HasPower() && tp.powerWatts >= 0 && tp.powerWatts <= std::numeric_limits<std::uint16_t>::max();
+
+	m_timeMs.push_back(tp.timeMs);
+	m_latitudeDegrees.push_back(hasPosition ? tp.latitudeDegrees : 0.0);
+	m_longitudeDegrees.push_back(hasPosition ? tp.longitudeDegrees : 0.0);
+	m_altitudeMeters.push_back(hasAltitude ? static_cast<float>(tp.altitudeMeters) : 0.0f);
+	m_distanceMeters.push_back(hasDistance ? tp.distanceMeters : 0.0);
+	m_heartRateBpm.push_back(hasHeartRate ? static_cast<std::uint8_t>(tp.heartRateBpm) : 0);
+	m_cadenceRpm.push_back(hasCadence ? static_cast<std::uint8_t>(tp.cadenceRpm) : 0);
+	m_powerWatts.push_back(hasPower ? static_cast<std::uint16_t>(tp.powerWatts) : 0);
+
+	m_hasPosition.PushBack(hasPosition);
+	m_hasAltitude.PushBack(hasAltitude);
+	m_hasDistance.PushBack(hasDistance);
+	m_hasHeartRate.PushBack(hasHeartRate);
+	m_hasCadence.PushBack(hasCadence);
+	m_hasPower.PushBack(hasPower);
+}
+
+void Track::BeginActivity(Sport sport) {
+	m_activityStarts.push_back(Size());
+	m_activitySports.push_back(sport);
+	BeginLap();
+}
+
+void Track::BeginLap() {
+	m_lapStarts.push_back(Size());
+}
+
+void Track::ShrinkToFit() {
+	m_timeMs.shrink_to_fit();
+	m_latitudeDegrees.shrink_to_fit();
+	m_longitudeDegrees.shrink_to_fit();
+	m_altitudeMeters.shrink_to_fit();
+	m_distanceMeters.shrink_to_fit();
+	m_heartRateBpm.shrink_to_fit();
+	m_cadenceRpm.shrink_to_fit();
+	m_powerWatts.shrink_to_fit();
+	m_hasPosition.ShrinkToFit();
+	m_hasAltitude.ShrinkToFit();
+	m_hasDistance.ShrinkToFit();
+	m_hasHeartRate.ShrinkToFit();
+	m_hasCadence.ShrinkToFit();
+	m_hasPower.ShrinkToFit();
+	m_activityStarts.shrink_to_fit();
+	m_activitySports.shrink_to_fit();
+	m_lapStarts.shrink_to_fit();
+}
+
+void Track::Clear() {
+	m_timeMs.clear();
+	m_latitudeDegrees.clear();
+	m_longitudeDegrees.clear();
+	m_altitudeMeters.clear();
+	m_distanceMeters.clear();
+	m_heartRateBpm.clear();
+	m_cadenceRpm.clear();
+	m_powerWatts.clear();
+	m_hasPosition.Clear();
+	m_hasAltitude.Clear();
+	m_hasDistance.Clear();
+	m_hasHeartRate.Clear();
+	m_hasCadence.Clear();
+	m_hasPower.Clear();
+	m_activityStarts.clear();
+	m_activitySports.clear();
+	m_lapStarts.clear();
+}
+
+Trackpoint Track::At(std::size_t index) const {
+	Trackpoint tp;
+	tp.timeMs = m_timeMs[index];
+	if (m_hasPosition.Test(index)) {
+		tp.latitudeDegrees = m_latitudeDegrees[index];
+		tp.longitudeDegrees = m_longitudeDegrees[index];
+	}
+	if (m_hasAltitude.Test(index)) tp.altitudeMeters = m_altitudeMeters[index];
+	if (m_hasDistance.Test(index)) tp.distanceMeters = m_distanceMeters[index];
+	if (m_hasHeartRate.Test(index)) tp.heartRateBpm = m_heartRateBpm[index];
+	if (m_hasCadence.Test(index)) tp.cadenceRpm = m_cadenceRpm[index];
+	if (m_hasPower.Test(index)) tp.powerWatts = m_powerWatts[index];
+	return tp;
+}
+
+std::size_t Track::GetMemoryUsage() const {
+	return m_timeMs.capacity() * sizeof(std::int64_t)
+		+ m_latitudeDegrees.capacity() * sizeof(double)
+		+ m_longitudeDegrees.capacity() * sizeof(double)
+		+ m_altitudeMeters.capacity() * sizeof(float)
+		+ m_distanceMeters.capacity() * sizeof(double)
+		+ m_heartRateBpm.capacity() * sizeof(std::uint8_t)
+		+ m_cadenceRpm.capacity() * sizeof(std::uint8_t)
+		+ m_powerWatts.capacity() * sizeof(std::uint16_t)
+		+ (m_hasPosition.GetWords().capacity() + m_hasAltitude.GetWords().capacity() + m_hasDistance.GetWords().capacity() + m_hasHeartRate.GetWords().capacity()
+			+ m_hasCadence.GetWords().capacity() + m_hasPower.GetWords().capacity()) * sizeof(std::uint64_t)
+		+ (m_activityStarts.capacity() + m_lapStarts.capacity()) * sizeof(std::uint64_t)
+		+ m_activitySports.capacity() * sizeof(Sport);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "Trackpoint.hpp"
+
+// The sports a TCX Activity can have.
+enum class Sport : std::uint8_t {
+	Running = 0,
+	Biking,
+	Other
+};
+
+// Name as used in the Sport attribute of the TCX file.
+char const* GetSportName(Sport sport);
+// Unknown names are Sport::Other.
+Sport GetSportByName(std::string_view name);
+
+// One validity bit per sample of a column.
+class ValidityMask {
+public:
+	inline void Reserve(std::size_t size) {
+		m_words.reserve((size + 63) / 64);
+	}
+	inline void PushBack(bool isValid) {
+		if ((m_size % 64) == 0) m_words.push_back(0);
+		if (isValid) m_words.back() |= (std::uint64_t(1) << (m_size % 64));
+		++m_size;
+	}
+	inline bool Test(std::size_t index) const {
+		return (m_words[index / 64] >> (index % 64)) & 1u;
+	}
+	inline std::size_t Size() const {
+		return m_size;
+	}
+	inline std::vector<std::uint64_t> const& GetWords() const {
+		return m_words;
+	}
+	inline void ShrinkToFit() {
+		m_words.shrink_to_fit();
+	}
+	// Removes all bits, but keeps the memory.
+	inline void Clear() {
+		m_words.clear();
+		m_size = 0;
+	}
+private:
+	std::vector<std::uint64_t> m_words;
+	std::size_t m_size = 0;
+
+	friend class TrackCache;
+};
+
+// The samples of all activities of a file, stored column-wise.
+// Times are kept as milliseconds since the epoch, optional values have a validity mask next to them (the value stored for an invalid sample is unspecified).
+// Activities and laps are kept as the index of their first sample, so activity a covers the samples [GetActivityStarts()[a], GetActivityStarts()[a + 1]).
+class Track {
+public:
+	void Reserve(std::size_t size);
+	void Append(Trackpoint const& tp);
+	// Start a new activity or lap with the next appended sample. A new activity always starts a new lap as well.
+	void BeginActivity(Sport sport);
+	void BeginLap();
+	void ShrinkToFit();
+	// Removes all samples, activities and laps, but keeps the memory for refilling the track.
+	void Clear();
+
+	// Reassembles a single sample, mainly for code that works point-wise.
+	Trackpoint At(std::size_t index) const;
+
+	inline std::size_t Size() const {
+		return m_timeMs.size();
+	}
+	inline bool Empty() const {
+		return m_timeMs.empty();
+	}
+	std::size_t GetMemoryUsage() const;
+
+	inline std::vector<std::int64_t> const& GetTimeMs() const {
+		return m_timeMs;
+	}
+	inline std::vector<double> const& GetLatitudeDegrees() const {
+		return m_latitudeDegrees;
+	}
+	inline std::vector<double> const& GetLongitudeDegrees() const {
+		return m_longitudeDegrees;
+	}
+	inline std::vector<float> const& GetAltitudeMeters() const {
+		return m_altitudeMeters;
+	}
+	inline std::vector<double> const& GetDistanceMeters() const {
+		return m_distanceMeters;
+	}
+	inline std::vector<std::uint8_t> const& GetHeartRateBpm() const {
+		return m_heartRateBpm;
+	}
+	inline std::vector<std::uint8_t> const& GetCadenceRpm() const {
+		return m_cadenceRpm;
+	}
+	inline std::vector<std::uint16_t> const& GetPowerWatts() const {
+		return m_powerWatts;
+	}
+
+	inline ValidityMask const& GetPositionValidity() const {
+		return m_hasPosition;
+	}
+	inline ValidityMask const& GetAltitudeValidity() const {
+		return m_hasAltitude;
+	}
+	inline ValidityMask const& GetDistanceValidity() const {
+		return m_hasDistance;
+	}
+	inline ValidityMask const& GetHeartRateValidity() const {
+		return m_hasHeartRate;
+	}
+	inline ValidityMask const& GetCadenceValidity() const {
+		return m_hasCadence;
+	}
+	inline ValidityMask const& GetPowerValidity() const {
+		return m_hasPower;
+	}
+
+	inline std::vector<std::uint64_t> const& GetActivityStarts() const {
+		return m_activityStarts;
+	}
+	inline std::vector<Sport> const& GetActivitySports() const {
+		return m_activitySports;
+	}
+	inline std::vector<std::uint64_t> const& GetLapStarts() const {
+		return m_lapStarts;
+	}
+	// Sport of the first activity, Sport::Other if there is none.
+	inline Sport GetSport() const {
+		return m_activitySports.empty() ? Sport::Other : m_activitySports.front();
+	}
+private:
+	std::vector<std::int64_t> m_timeMs;
+	std::vector<double> m_latitudeDegrees;
+	std::vector<double> m_longitudeDegrees;
+	std::vector<float> m_altitudeMeters;
+	std::vector<double> m_distanceMeters;
+	std::vector<std::uint8_t> m_heartRateBpm;
+	std::vector<std::uint8_t> m_cadenceRpm;
+	std::vector<std::uint16_t> m_powerWatts;
+
+	ValidityMask m_hasPosition;
+	ValidityMask m_hasAltitude;
+	ValidityMask m_hasDistance;
+	ValidityMask m_hasHeartRate;
+	ValidityMask m_hasCadence;
+	ValidityMask m_hasPower;
+
+	std::vector<std::uint64_t> m_activityStarts;
+	std::vector<Sport> m_activitySports;
+	std::vector<std::uint64_t> m_lapStarts;
+
+	friend class TrackCache;
+};
@@ -0,0 +1,323 @@
+#include "TrackCache.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "AtomicFileWrite.hpp"
+#include "MappedFileString.hpp"
+#include "Trace.hpp"
+
+static constexpr char CACHE_MAGIC[8] = { 'T', 'C', 'X', 'C', 'A', 'C', 'H', 'E' };
+// Written as a number, reads differently on a machine with another byte order
+static constexpr std::uint32_t CACHE_BYTE_ORDER_MARK = 0x01020304u;
+static constexpr std::size_t CACHE_ALIGNMENT = 64;
+
+enum class CacheColumn : std::uint32_t {
+	TimeMs = 1,
+	LatitudeDegrees,
+	LongitudeDegrees,
+	AltitudeMeters,
+	DistanceMeters,
+	HeartRateBpm,
+	HasPosition,
+	HasAltitude,
+	HasDistance,
+	HasHeartRate,
+	CadenceRpm,
+	PowerWatts,
+	HasCadence,
+	HasPower,
+	ActivityStarts,
+	ActivitySports,
+	LapStarts
+};
+
+struct CacheHeader {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byteOrderMark;
+	std::uint64_t sourceSize;
+	std::int64_t sourceModificationTimeNs;
+	std::uint64_t pointCount;
+	std::uint64_t activityCount;
+	std::uint64_t lapCount;
+	std::uint64_t checksum;
+	std::uint32_t columnCount;
+	std::uint32_t reserved;
+};
+
+struct CacheColumnEntry {
+	std::uint32_t column;
+	std::uint32_t elementSize;
+	std::uint64_t offset;
+	std::uint64_t byteSize;
+};
+
+static_assert(std::is_trivially_copyable_v<CacheHeader> && std::is_trivially_copyable_v<CacheColumnEntry>);
+
+template<typename TrackType, typename Function>
+void TrackCache::ForEachColumn(TrackType& track, Function&& function) {
+	function(CacheColumn::TimeMs, track.m_timeMs, ColumnLength::Points);
+	function(CacheColumn::LatitudeDegrees, track.m_latitudeDegrees, ColumnLength::Points);
+	function(CacheColumn::LongitudeDegrees, track.m_longitudeDegrees, ColumnLength::Points);
+	function(CacheColumn::AltitudeMeters, track.m_altitudeMeters, ColumnLength::Points);
+	function(CacheColumn::DistanceMeters, track.m_distanceMeters, ColumnLength::Points);
+	function(CacheColumn::HeartRateBpm, track.m_heartRateBpm, ColumnLength::Points);
+	function(CacheColumn::CadenceRpm, track.m_cadenceRpm, ColumnLength::Points);
+	function(CacheColumn::PowerWatts, track.m_powerWatts, ColumnLength::Points);
+	function(CacheColumn::HasPosition, track.m_hasPosition, ColumnLength::Points);
+	function(CacheColumn::HasAltitude, track.m_hasAltitude, ColumnLength::Points);
+	function(CacheColumn::HasDistance, track.m_hasDistance, ColumnLength::Points);
+	function(CacheColumn::HasHeartRate, track.m_hasHeartRate, ColumnLength::Points);
+	function(CacheColumn::HasCadence, track.m_hasCadence, ColumnLength::Points);
+	function(CacheColumn::HasPower, track.m_hasPower, ColumnLength::Points);
+	function(CacheColumn::ActivityStarts, track.m_activityStarts, ColumnLength::Activities);
+	function(CacheColumn::ActivitySports, track.m_activitySports, ColumnLength::Activities);
+	function(CacheColumn::LapStarts, track.m_lapStarts, ColumnLength::Laps);
+}
+
+template<typename Column>
+static inline constexpr bool IsValidityMask = std::is_same_v<std::remove_const_t<Column>, ValidityMask>;
+
+// Element size and number of elements of a column as stored in the file
+template<typename Column>
+static inline std::uint32_t GetElementSize() {
+	if constexpr (IsValidityMask<Column>) {
+		return sizeof(std::uint64_t);
+	} else {
+		return sizeof(typename Column::value_type);
+	}
+}
+
+static inline std::size_t GetElementCount(std::size_t length, bool isValidityMask) {
+	return isValidityMask ? ((length + 63) / 64) : length;
+}
+
+static inline std::size_t AlignUp(std::size_t value) {
+	return (value + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+}
+
+// FNV-1a over 64 bit words instead of bytes, which is plenty for detecting damaged files and several times faster.
+static std::uint64_t UpdateChecksum(std::uint64_t hash, void const* data, std::size_t size) {
+	static constexpr std::uint64_t FNV_PRIME = 1099511628211ull;
+	unsigned char const* bytes = static_cast<unsigned char const*>(data);
+	std::size_t i = 0;
+	for (; (i + 8) <= size; i += 8) {
+		std::uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ word) * FNV_PRIME;
+	}
+	for (; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+static constexpr std::uint64_t CHECKSUM_SEED = 14695981039346656037ull;
+
+std::optional<TrackCache::SourceInfo> TrackCache::GetSourceInfo(std::filesystem::path const& sourceFile) {
+	std::error_code error;
+	auto const size = std::filesystem::file_size(sourceFile, error);
+	if (error) return std::nullopt;
+	auto const modificationTime = std::filesystem::last_write_time(sourceFile, error);
+	if (error) return std::nullopt;
+	return SourceInfo{ static_cast<std::uint64_t>(size), static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(modificationTime.time_since_epoch()).count()) };
+}
+
+std::filesystem::path TrackCache::GetCachePath(std::filesystem::path const& sourceFile) {
+	std::filesystem::path result = sourceFile;
+	result += ".tcxcache";
+	return result;
+}
+
+std::optional<Track> TrackCache::Read(std::filesystem::path const& sourceFile) {
+	TRACE_SCOPE("Read track cache");
+	auto const sourceInfo = GetSourceInfo(sourceFile);
+	auto const cacheFile = GetCachePath(sourceFile);
+	std::error_code error;
+	if (!sourceInfo.has_value() || !std::filesystem::is_regular_file(cacheFile, error)) {
+		return std::nullopt;
+	}
+
+	std::optional<MappedFileString> mappedCache;
+	try {
+		mappedCache.emplace(cacheFile.string());
+	}
+	catch (std::system_error const&) {
+		return std::nullopt;
+	}
+	std::string_view const content = mappedCache.value().GetView();
+
+	CacheHeader header;
+	if (content.size() < sizeof(header)) return std::nullopt;
+	std::memcpy(&header, content.data(), sizeof(header));
+	if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != VERSION || header.byteOrderMark != CACHE_BYTE_ORDER_MARK) {
+		return std::nullopt;
+	}
+	if (header.sourceSize != sourceInfo.value().size || header.sourceModificationTimeNs != sourceInfo.value().modificationTimeNs) {
+		return std::nullopt;
+	}
+
+	// Every point, activity and lap takes at least one byte of the file, this keeps a damaged count from causing huge allocations below
+	if (header.pointCount > content.size() || header.activityCount > content.size() || header.lapCount > content.size()) {
+		return std::nullopt;
+	}
+
+	Track track;
+	std::size_t const pointCount = static_cast<std::size_t>(header.pointCount);
+	auto const getLength = [&](ColumnLength length) {
+		return static_cast<std::size_t>((length == ColumnLength::Points) ? header.pointCount : ((length == ColumnLength::Activities) ? header.activityCount : header.lapCount));
+	};
+	std::uint32_t columnIndex = 0;
+	std::uint64_t checksum = CHECKSUM_SEED;
+	bool isValid = true;
+	ForEachColumn(track, [&](CacheColumn column, auto& data, ColumnLength length) {
+		using Column = std::remove_reference_t<decltype(data)>;
+		if (!isValid) return;
+
+		CacheColumnEntry entry;
+		std::size_t const entryOffset = sizeof(CacheHeader) + columnIndex * sizeof(CacheColumnEntry);
+		++columnIndex;
+		if (columnIndex > header.columnCount || (entryOffset + sizeof(entry)) > content.size()) {
+			isValid = false;
+			return;
+		}
+		std::memcpy(&entry, content.data() + entryOffset, sizeof(entry));
+
+		std::size_t const elementCount = GetElementCount(getLength(length), IsValidityMask<Column>);
+		std::uint32_t const elementSize = GetElementSize<Column>();
+		if (entry.column != static_cast<std::uint32_t>(column) || entry.elementSize != elementSize || entry.byteSize != elementCount * elementSize
+			|| (entry.offset % CACHE_ALIGNMENT) != 0 || entry.offset > content.size() || entry.byteSize > (content.size() - entry.offset)) {
+			isValid = false;
+			return;
+		}
+
+		char const* const bytes = content.data() + entry.offset;
+		std::size_t const byteSize = static_cast<std::size_t>(entry.byteSize);
+		checksum = UpdateChecksum(checksum, bytes, byteSize);
+		if constexpr (IsValidityMask<Column>) {
+			data.m_words.resize(elementCount);
+			if (byteSize > 0) std::memcpy(data.m_words.data(), bytes, byteSize);
+			data.m_size = pointCount;
+		} else {
+			data.resize(elementCount);
+			if (byteSize > 0) std::memcpy(data.data(), bytes, byteSize);
+		}
+	});
+
+	if (!isValid || columnIndex != header.columnCount || checksum != header.checksum) {
+		return std::nullopt;
+	}
+	return track;
+}
+
+void TrackCache::Write(std::filesystem::path const& sourceFile, Track const& track) {
+	auto const sourceInfo = GetSourceInfo(sourceFile);
+	if (!sourceInfo.has_value()) {
+		throw std::runtime_error("Failed to get size and modification time of '" + sourceFile.string() + "'!");
+	}
+	Write(sourceFile, sourceInfo.value(), track);
+}
+
+void TrackCache::Write(std::filesystem::path const& sourceFile, SourceInfo const& sourceInfo, Track const& track) {
+	TRACE_SCOPE("Write track cache");
+	CacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = VERSION;
+	header.byteOrderMark = CACHE_BYTE_ORDER_MARK;
+	header.sourceSize = sourceInfo.size;
+	header.sourceModificationTimeNs = sourceInfo.modificationTimeNs;
+	header.pointCount = track.Size();
+	header.activityCount = track.GetActivityStarts().size();
+	header.lapCount = track.GetLapStarts().size();
+	header.checksum = CHECKSUM_SEED;
+	header.columnCount = 0;
+	header.reserved = 0;
+
+	struct ColumnData {
+		CacheColumnEntry entry;
+		void const* data;
+	};
+	auto const getLength = [&](ColumnLength length) {
+		return (length == ColumnLength::Points) ? track.Size() : ((length == ColumnLength::Activities) ? track.GetActivityStarts().size() : track.GetLapStarts().size());
+	};
+	std::vector<ColumnData> columns;
+	ForEachColumn(track, [&](CacheColumn column, auto const& data, ColumnLength length) {
+		using Column = std::remove_reference_t<decltype(data)>;
+		ColumnData columnData;
+		columnData.entry.column = static_cast<std::uint32_t>(column);
+		columnData.entry.elementSize = GetElementSize<Column>();
+		columnData.entry.offset = 0;
+		columnData.entry.byteSize = GetElementCount(getLength(length), IsValidityMask<Column>) * columnData.entry.elementSize;
+		if constexpr (IsValidityMask<Column>) {
+			columnData.data = data.m_words.data();
+		} else {
+			columnData.data = data.data();
+		}
+		columns.push_back(columnData);
+	});
+	header.columnCount = static_cast<std::uint32_t>(columns.size());
+
+	std::size_t offset = AlignUp(sizeof(CacheHeader) + columns.size() * sizeof(CacheColumnEntry));
+	for (auto& column : columns) {
+		column.entry.offset = offset;
+		offset = AlignUp(offset + static_cast<std::size_t>(column.entry.byteSize));
+		header.checksum = UpdateChecksum(header.checksum, column.data, static_cast<std::size_t>(column.entry.byteSize));
+	}
+	std::size_t const fileSize = offset;
+
+	WriteFileAtomically(GetCachePath(sourceFile), [&](std::ostream& out) {
+		static constexpr char PADDING[CACHE_ALIGNMENT] = {};
+		std::size_t position = 0;
+		auto const write = [&](void const* data, std::size_t size) {
+			out.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+			position += size;
+		};
+		auto const padTo = [&](std::size_t target) {
+			write(PADDING, target - position);
+		};
+
+		write(&header, sizeof(header));
+		for (auto const& column : columns) {
+			write(&column.entry, sizeof(column.entry));
+		}
+		for (auto const& column : columns) {
+			padTo(static_cast<std::size_t>(column.entry.offset));
+			write(column.data, static_cast<std::size_t>(column.entry.byteSize));
+		}
+		padTo(fileSize);
+	});
+}
+
+Track TrackCache::Load(std::filesystem::path const& sourceFile, bool doDebugOutput, ParserBackend backend, unsigned int threadCount, ParseProgressCallback const& progressCallback, bool* wasCached) {
+	auto cachedTrack = Read(sourceFile);
+	if (wasCached != nullptr) *wasCached = cachedTrack.has_value();
+	if (cachedTrack.has_value()) {
+		if (doDebugOutput) std::cerr << "Using cache of '" << sourceFile.string() << "'." << std::endl;
+		if (progressCallback) {
+			progressCallback(1, 1);
+		}
+		return std::move(cachedTrack.value());
+	}
+
+	// Taken before parsing, so a file changed in the meantime does not end up with a cache of its old content that looks up to date
+	auto const sourceInfo = GetSourceInfo(sourceFile);
+	Parser parser(sourceFile, doDebugOutput, backend, threadCount, progressCallback);
+	Track track = parser.TakeTrack();
+	try {
+		if (!sourceInfo.has_value()) {
+			throw std::runtime_error("Failed to get size and modification time of '" + sourceFile.string() + "'!");
+		}
+		Write(sourceFile, sourceInfo.value(), track);
+	}
+	catch (std::exception const& e) {
+		if (doDebugOutput) std::cerr << "Warning: " << e.what() << std::endl;
+	}
+	return track;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+#include "Parser.hpp"
+#include "Track.hpp"
+
+// Binary cache of parsed tracks, so opening a file again does not need to parse any XML.
+// A cache file is a small header, followed by a table of the columns and the columns of the Track exactly as they are in memory, each aligned to 64 bytes.
+// The header records size and modification time of the TCX file it was made from and a checksum of the columns. A cache that does not match is ignored.
+// Cache files are meant for the machine they were written on, they use its byte order.
+class TrackCache {
+public:
+	// Has to be increased whenever the stored columns change, in layout or meaning (e.g. because the parser keeps other samples).
+	static constexpr std::uint32_t VERSION = 4;
+
+	// The cache is a sidecar of the source file: "run.tcx" is cached in "run.tcx.tcxcache".
+	static std::filesystem::path GetCachePath(std::filesystem::path const& sourceFile);
+
+	// Returns nullopt if there is no cache for sourceFile, or if it is outdated, of another version or damaged.
+	static std::optional<Track> Read(std::filesystem::path const& sourceFile);
+	// Replaces the cache of sourceFile, readers never see a partially written one. Throws std::runtime_error if the cache can not be written.
+	static void Write(std::filesystem::path const& sourceFile, Track const& track);
+	// Reads the cache if it is up to date, otherwise parses the file and (re-)writes its cache. Failing to write the cache is not an error.
+	static Track Load(std::filesystem::path const& sourceFile, bool doDebugOutput, ParserBackend backend, unsigned int threadCount = 0, ParseProgressCallback const& progressCallback = ParseProgressCallback(), bool* wasCached = nullptr);
+
+	// What a cache (or anything else derived from a file) remembers of its source, to tell whether it is still up to date.
+	struct SourceInfo {
+		std::uint64_t size;
+		std::int64_t modificationTimeNs;
+	};
+	// Returns nullopt if the file does not exist or can not be accessed.
+	static std::optional<SourceInfo> GetSourceInfo(std::filesystem::path const& sourceFile);
+	// Like Write(), but records the given source info instead of the current one. Taking it before parsing makes sure
+	// a file changed in the meantime does not end up with a cache of its old content that looks up to date.
+	static void Write(std::filesystem::path const& sourceFile, SourceInfo const& sourceInfo, Track const& track);
+private:
+
+	// Number of values of a column, a ValidityMask of n points has (n + 63) / 64 words.
+	enum class ColumnLength {
+		Points,
+		Activities,
+		Laps
+	};
+	// Calls function(columnId, column, length) for every column of the track in file order, where column is a std::vector of the values or a ValidityMask.
+	template<typename TrackType, typename Function>
+	static void ForEachColumn(TrackType& track, Function&& function);
+};
@@ -0,0 +1,184 @@
+#include "TrackLoader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+#include "Trace.hpp"
+#include "TrackCache.hpp"
+
+TrackLoader::TrackLoader(bool doDebugOutput, ParserBackend backend, bool useTrackCache, QObject* parent)
+	: QObject(parent)
+	, m_doDebugOutput(doDebugOutput)
+	, m_backend(backend)
+	, m_useTrackCache(useTrackCache)
+{
+	//
+}
+
+TrackLoader::~TrackLoader() {
+	// The workers emit signals of this object, so they have to be gone before the QObject is
+	for (auto& worker : m_workers) {
+		worker->thread.request_stop();
+	}
+	m_workers.clear();
+}
+
+quint64 TrackLoader::Load(std::filesystem::path const& file) {
+	return StartWorker([this, file](std::stop_token stopToken, quint64 generation) {
+		Run(stopToken, generation, file);
+	});
+}
+
+quint64 TrackLoader::Load(std::vector<std::filesystem::path> const& files) {
+	return StartWorker([this, files](std::stop_token stopToken, quint64 generation) {
+		RunBatch(stopToken, generation, files);
+	});
+}
+
+void TrackLoader::Cancel() {
+	if (!m_workers.empty()) {
+		m_workers.back()->thread.request_stop();
+	}
+}
+
+quint64 TrackLoader::StartWorker(std::function<void(std::stop_token stopToken, quint64 generation)> work) {
+	quint64 const generation = ++m_generation;
+	// Joining the older workers here would block the GUI until they stopped, so they are only asked to and joined once done
+	for (auto& worker : m_workers) {
+		worker->thread.request_stop();
+	}
+	std::erase_if(m_workers, [](std::unique_ptr<Worker> const& worker) { return worker->isDone.load(); });
+
+	Worker& worker = *m_workers.emplace_back(std::make_unique<Worker>());
+	worker.thread = std::jthread([&worker, generation, work = std::move(work)](std::stop_token stopToken) {
+		work(stopToken, generation);
+		worker.isDone = true;
+	});
+	return generation;
+}
+
+std::optional<Track> TrackLoader::TakeTrack(quint64 generation) {
+	std::lock_guard<std::mutex> lock(m_resultMutex);
+	if (m_resultGeneration != generation || !m_result.has_value()) {
+		return std::nullopt;
+	}
+	std::optional<Track> result = std::move(m_result);
+	m_result.reset();
+	return result;
+}
+
+std::vector<BatchResult> TrackLoader::TakeResults(quint64 generation) {
+	std::lock_guard<std::mutex> lock(m_resultMutex);
+	if (m_resultGeneration != generation) {
+		return {};
+	}
+	return std::move(m_batchResults);
+}
+
+void TrackLoader::Run(std::stop_token stopToken, quint64 generation, std::filesystem::path const& file) {
+	auto const timeStart = std::chrono::steady_clock::now();
+	// Only report whole per mille steps, every report is a queued event for the GUI thread
+	qint64 lastPermille = -1;
+	auto const progress = [&](std::size_t bytesDone, std::size_t bytesTotal) {
+		qint64 const permille = (bytesTotal > 0) ? static_cast<qint64>((bytesDone * 1000) / bytesTotal) : 1000;
+		if (permille != lastPermille) {
+			lastPermille = permille;
+			emit loadProgress(generation, static_cast<qint64>(bytesDone), static_cast<qint64>(bytesTotal));
+		}
+		return !stopToken.stop_requested();
+	};
+
+	try {
+		TRACE_SCOPE("Load track");
+		Track track;
+		if (m_useTrackCache) {
+			track = TrackCache::Load(file, m_doDebugOutput, m_backend, 0, progress);
+		}
+		else {
+			Parser parser(file, m_doDebugOutput, m_backend, 0, progress);
+			track = parser.TakeTrack();
+		}
+		bool isStopped = false;
+		{
+			std::lock_guard<std::mutex> lock(m_resultMutex);
+			// Every newer load asks this one to stop before it starts, so checking under the lock never overwrites a newer result
+			isStopped = stopToken.stop_requested();
+			if (!isStopped) {
+				m_result = std::move(track);
+				m_resultGeneration = generation;
+			}
+		}
+		if (isStopped) {
+			emit loadCancelled(generation);
+			return;
+		}
+	}
+	catch (ParseCancelled const&) {
+		if (m_doDebugOutput) std::cerr << "Loading '" << file.string() << "' was cancelled." << std::endl;
+		emit loadCancelled(generation);
+		return;
+	}
+	catch (std::exception const& e) {
+		if (m_doDebugOutput) std::cerr << e.what() << std::endl;
+		emit loadFailed(generation, QString::fromStdString(e.what()));
+		return;
+	}
+
+	auto const timeEnd = std::chrono::steady_clock::now();
+	emit loadFinished(generation, std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count());
+}
+
+void TrackLoader::RunBatch(std::stop_token stopToken, quint64 generation, std::vector<std::filesystem::path> const& files) {
+	auto const timeStart = std::chrono::steady_clock::now();
+	std::vector<BatchResult> results;
+	results.reserve(files.size());
+	std::string lastError;
+
+	try {
+		TRACE_SCOPE("Load tracks");
+		BatchLoader const loader(0, 0, m_useTrackCache);
+		loader.Load(files, m_doDebugOutput, m_backend, [&](BatchResult&& result) {
+			if (!result.track.has_value()) {
+				if (m_doDebugOutput) std::cerr << result.errorMessage << std::endl;
+				lastError = result.errorMessage;
+			}
+			results.push_back(std::move(result));
+			emit loadProgress(generation, static_cast<qint64>(results.size()), static_cast<qint64>(files.size()));
+		}, [&stopToken]() { return stopToken.stop_requested(); });
+	}
+	catch (ParseCancelled const&) {
+		if (m_doDebugOutput) std::cerr << "Loading " << files.size() << " files was cancelled." << std::endl;
+		emit loadCancelled(generation);
+		return;
+	}
+	catch (std::exception const& e) {
+		if (m_doDebugOutput) std::cerr << e.what() << std::endl;
+		emit loadFailed(generation, QString::fromStdString(e.what()));
+		return;
+	}
+
+	bool const hasTrack = std::any_of(results.cbegin(), results.cend(), [](BatchResult const& result) { return result.track.has_value(); });
+	if (!hasTrack) {
+		emit loadFailed(generation, QString::fromStdString(files.empty() ? std::string("No files given.") : lastError));
+		return;
+	}
+	bool isStopped = false;
+	{
+		std::lock_guard<std::mutex> lock(m_resultMutex);
+		// Same as in Run()
+		isStopped = stopToken.stop_requested();
+		if (!isStopped) {
+			m_batchResults = std::move(results);
+			m_resultGeneration = generation;
+		}
+	}
+	if (isStopped) {
+		emit loadCancelled(generation);
+		return;
+	}
+
+	auto const timeEnd = std::chrono::steady_clock::now();
+	emit loadFinished(generation, std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count());
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <QObject>
+#include <QString>
+
+#include "BatchLoader.hpp"
+#include "Parser.hpp"
+#include "Track.hpp"
+
+// Parses TCX files on a worker thread, so the GUI stays responsive while loading large files.
+// Every call of Load() starts a new generation on a new worker and cancels the load still running, without waiting for it. All signals carry
+// the generation they belong to, so receivers can drop the ones of loads they are no longer interested in. Signals are emitted from the worker thread.
+class TrackLoader : public QObject {
+    Q_OBJECT
+public:
+    // With useTrackCache, files are read from their TrackCache where possible and caches are written for the others.
+    TrackLoader(bool doDebugOutput, ParserBackend backend, bool useTrackCache, QObject* parent = nullptr);
+    virtual ~TrackLoader();
+
+    // Cancels the load still running and starts loading the given file. Returns the generation of the new load.
+    quint64 Load(std::filesystem::path const& file);
+    // Like Load(), but parses all given files concurrently with a BatchLoader. Progress counts files instead of bytes.
+    // loadFailed is only emitted if none of the files could be loaded, the errors of the others are in their results.
+    quint64 Load(std::vector<std::filesystem::path> const& files);
+    // Asks the current load to stop. loadCancelled is emitted once it did.
+    void Cancel();
+
+    // Hands out the track of a load after loadFinished was emitted for it. Empty if a newer load finished in between.
+    std::optional<Track> TakeTrack(quint64 generation);
+    // Hands out the results of a load of several files after loadFinished was emitted for it, in the order of the files.
+    // Empty if a newer load finished in between.
+    std::vector<BatchResult> TakeResults(quint64 generation);
+
+signals:
+    void loadProgress(quint64 generation, qint64 bytesDone, qint64 bytesTotal);
+    void loadFinished(quint64 generation, qint64 durationMs);
+    void loadFailed(quint64 generation, QString message);
+    void loadCancelled(quint64 generation);
+private:
+    bool const m_doDebugOutput;
+    ParserBackend const m_backend;
+    bool const m_useTrackCache;
+    quint64 m_generation = 0;
+
+    std::mutex m_resultMutex;
+    std::optional<Track> m_result;
+    std::vector<BatchResult> m_batchResults;
+    quint64 m_resultGeneration = 0;
+
+    struct Worker {
+        std::jthread thread;
+        // Set by the worker when it is done, so joining it no longer blocks
+        std::atomic<bool> isDone = false;
+    };
+    // The last one belongs to the current generation, the others were asked to stop and are joined once they are done
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    quint64 StartWorker(std::function<void(std::stop_token stopToken, quint64 generation)> work);
+    void Run(std::stop_token stopToken, quint64 generation, std::filesystem::path const& file);
+    void RunBatch(std::stop_token stopToken, quint64 generation, std::vector<std::filesystem::path> const& files);
+};
@@ -1,13 +1,12 @@
 #include "Trackpoint.hpp"
 
-
-static constexpr double INVALID_VALUE = -999999.999;
-
 Trackpoint::Trackpoint() :
-	dateTime(), 
+	timeMs(0),
 	latitudeDegrees(INVALID_VALUE), 
 	longitudeDegrees(INVALID_VALUE), 
 	altitudeMeters(INVALID_VALUE), 
 	distanceMeters(INVALID_VALUE), 
-	heartRateBpm(-999)
+	heartRateBpm(INVALID_HEART_RATE),
+	cadenceRpm(INVALID_CADENCE),
+	powerWatts(INVALID_POWER)
 {}
@@ -1,17 +1,48 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 
-#include <QDateTime>
-
+// A single sample as read from the file. Tracks are stored column-wise in Track, this is only used while parsing and for single-point access.
 struct Trackpoint {
-	QDateTime dateTime;
+	static constexpr double INVALID_VALUE = -999999.999;
+	static constexpr std::int_fast16_t INVALID_HEART_RATE = -999;
+	static constexpr std::int_fast16_t INVALID_CADENCE = -999;
+	static constexpr std::int_fast32_t INVALID_POWER = -999;
+
+	// Milliseconds since the epoch (UTC)
+	std::int64_t timeMs;
 
 	double latitudeDegrees;
 	double longitudeDegrees;
 	double altitudeMeters;
 	double distanceMeters;
 	std::int_fast16_t heartRateBpm;
+	// Cadence of the trackpoint itself (cycling) or RunCadence of the TPX extension (running)
+	std::int_fast16_t cadenceRpm;
+	// Watts of the TPX extension
+	std::int_fast32_t powerWatts;
 
 	Trackpoint();
+
+	inline bool HasPosition() const {
+		return latitudeDegrees != INVALID_VALUE && longitudeDegrees != INVALID_VALUE;
+	}
+	inline bool HasAltitude() const {
+		return altitudeMeters != INVALID_VALUE;
+	}
+	inline bool HasDistance() const {
+		return distanceMeters != INVALID_VALUE;
+	}
+	inline bool HasHeartRate() const {
+		return heartRateBpm != INVALID_HEART_RATE;
+	}
+	inline bool HasCadence() const {
+		return cadenceRpm != INVALID_CADENCE;
+	}
+	inline bool HasPower() const {
+		return powerWatts != INVALID_POWER;
+	}
 };
+
+static_assert(std::is_trivially_copyable_v<Trackpoint>, "Trackpoint is copied around a lot and should stay trivially copyable");
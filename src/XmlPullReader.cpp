@@ -0,0 +1,241 @@
+#include "XmlPullReader.hpp"
+
+#include <algorithm>
+
+static inline bool IsXmlWhitespace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline char ToLowerAscii(char c) {
+	return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+XmlPullReader::XmlPullReader(std::string_view input) : m_input(input) {
+	m_openElements.reserve(16);
+}
+
+bool XmlPullReader::NameEquals(std::string_view a, std::string_view b) {
+	if (a.size() != b.size()) return false;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if (ToLowerAscii(a[i]) != ToLowerAscii(b[i])) return false;
+	}
+	return true;
+}
+
+std::string_view XmlPullReader::Trim(std::string_view s) {
+	while (!s.empty() && IsXmlWhitespace(s.front())) s.remove_prefix(1);
+	while (!s.empty() && IsXmlWhitespace(s.back())) s.remove_suffix(1);
+	return s;
+}
+
+std::string_view XmlPullReader::GetName() const {
+	auto const colon = m_name.find(':');
+	if (colon == std::string_view::npos) return m_name;
+	return m_name.substr(colon + 1);
+}
+
+std::optional<std::string_view> XmlPullReader::GetAttribute(std::string_view name) const {
+	std::size_t pos = 0;
+	while (pos < m_attributes.size()) {
+		while (pos < m_attributes.size() && IsXmlWhitespace(m_attributes[pos])) ++pos;
+		std::size_t const nameStart = pos;
+		while (pos < m_attributes.size() && m_attributes[pos] != '=' && !IsXmlWhitespace(m_attributes[pos])) ++pos;
+		std::string_view const attributeName = m_attributes.substr(nameStart, pos - nameStart);
+		while (pos < m_attributes.size() && (IsXmlWhitespace(m_attributes[pos]) || m_attributes[pos] == '=')) ++pos;
+		if (pos >= m_attributes.size()) break;
+
+		char const quote = m_attributes[pos];
+		if (quote != '"' && quote != '\'') break;
+		std::size_t const valueStart = ++pos;
+		while (pos < m_attributes.size() && m_attributes[pos] != quote) ++pos;
+		std::string_view const value = m_attributes.substr(valueStart, pos - valueStart);
+		++pos;
+
+		if (attributeName == name) return value;
+	}
+	return std::nullopt;
+}
+
+XmlPullReader::Token XmlPullReader::SetError(std::string const& message) {
+	m_errorMessage = message;
+	m_token = Token::Error;
+	return m_token;
+}
+
+bool XmlPullReader::SkipPast(std::string_view terminator) {
+	auto const end = m_input.find(terminator, m_position);
+	if (end == std::string_view::npos) {
+		return false;
+	}
+	m_position = end + terminator.size();
+	return true;
+}
+
+void XmlPullReader::SkipTo(std::size_t offset) {
+	m_position = std::min(offset, m_input.size());
+	m_pendingSelfCloseEnd = false;
+}
+
+XmlPullReader::Token XmlPullReader::ReadNext() {
+	if (m_token == Token::Error && !m_errorMessage.empty()) {
+		return m_token;
+	}
+
+	m_text = std::string_view();
+	if (m_pendingSelfCloseEnd) {
+		m_pendingSelfCloseEnd = false;
+		m_openElements.pop_back();
+		m_attributes = std::string_view();
+		m_token = Token::EndElement;
+		return m_token;
+	}
+
+	while (m_position < m_input.size()) {
+		m_tokenStart = m_position;
+		if (m_input[m_position] != '<') {
+			std::size_t end = m_input.find('<', m_position);
+			if (end == std::string_view::npos) end = m_input.size();
+			std::string_view const text = m_input.substr(m_position, end - m_position);
+			m_position = end;
+			if (Trim(text).empty()) {
+				continue;
+			}
+			if (m_openElements.empty()) {
+				return SetError("Text outside of the root element");
+			}
+			m_text = text;
+			m_token = Token::Text;
+			return m_token;
+		}
+
+		std::string_view const rest = m_input.substr(m_position);
+		if (rest.starts_with("<?")) {
+			if (!SkipPast("?>")) return SetError("Unterminated processing instruction");
+			continue;
+		}
+		else if (rest.starts_with("<!--")) {
+			if (!SkipPast("-->")) return SetError("Unterminated comment");
+			continue;
+		}
+		else if (rest.starts_with("<![CDATA[")) {
+			std::size_t const start = m_position + 9;
+			if (!SkipPast("]]>")) return SetError("Unterminated CDATA section");
+			m_text = m_input.substr(start, m_position - 3 - start);
+			m_token = Token::Text;
+			return m_token;
+		}
+		else if (rest.starts_with("<!")) {
+			if (!SkipPast(">")) return SetError("Unterminated declaration");
+			continue;
+		}
+		else if (rest.starts_with("</")) {
+			std::size_t const nameStart = m_position + 2;
+			if (!SkipPast(">")) return SetError("Unterminated end tag");
+			m_name = Trim(m_input.substr(nameStart, m_position - 1 - nameStart));
+			m_attributes = std::string_view();
+			if (m_openElements.empty() || m_openElements.back() != m_name) {
+				return SetError("Unexpected end tag '" + std::string(m_name) + "'");
+			}
+			m_openElements.pop_back();
+			m_token = Token::EndElement;
+			return m_token;
+		}
+
+		// Start tag, find its end while respecting quoted attribute values
+		std::size_t pos = m_position + 1;
+		char quote = 0;
+		while (pos < m_input.size()) {
+			char const c = m_input[pos];
+			if (quote != 0) {
+				if (c == quote) quote = 0;
+			}
+			else if (c == '"' || c == '\'') {
+				quote = c;
+			}
+			else if (c == '>') {
+				break;
+			}
+			++pos;
+		}
+		if (pos >= m_input.size()) return SetError("Unterminated start tag");
+
+		bool const isSelfClosing = m_input[pos - 1] == '/';
+		std::size_t const contentEnd = isSelfClosing ? (pos - 1) : pos;
+		std::size_t nameEnd = m_position + 1;
+		while (nameEnd < contentEnd && !IsXmlWhitespace(m_input[nameEnd])) ++nameEnd;
+
+		m_name = m_input.substr(m_position + 1, nameEnd - m_position - 1);
+		if (m_name.empty()) return SetError("Start tag without a name");
+		m_attributes = m_input.substr(nameEnd, contentEnd - nameEnd);
+		m_position = pos + 1;
+
+		m_openElements.push_back(m_name);
+		m_pendingSelfCloseEnd = isSelfClosing;
+		m_token = Token::StartElement;
+		return m_token;
+	}
+
+	m_tokenStart = m_position;
+	if (!m_openElements.empty()) {
+		return SetError("Unexpected end of document, element '" + std::string(m_openElements.back()) + "' is still open");
+	}
+	m_token = Token::EndOfDocument;
+	return m_token;
+}
+
+std::optional<std::string_view> XmlPullReader::ReadElementText() {
+	if (m_token != Token::StartElement) return std::nullopt;
+
+	std::string_view result;
+	bool haveText = false;
+	while (true) {
+		switch (ReadNext()) {
+		case Token::Text:
+			if (haveText) {
+				SetError("Element '" + std::string(m_openElements.back()) + "' has mixed or split text content");
+				return std::nullopt;
+			}
+			haveText = true;
+			result = Trim(m_text);
+			break;
+		case Token::EndElement:
+			return result;
+		case Token::StartElement:
+			SetError("Element '" + std::string(m_openElements.at(m_openElements.size() - 2)) + "' was expected to only contain text, but has child '" + std::string(m_name) + "'");
+			return std::nullopt;
+		default:
+			return std::nullopt;
+		}
+	}
+}
+
+bool XmlPullReader::SkipCurrentElement() {
+	if (m_token != Token::StartElement) return false;
+
+	std::size_t const targetDepth = m_openElements.size() - 1;
+	while (true) {
+		auto const token = ReadNext();
+		if (token == Token::EndElement && m_openElements.size() == targetDepth) {
+			return true;
+		}
+		else if (token == Token::Error || token == Token::EndOfDocument) {
+			return false;
+		}
+	}
+}
+
+std::size_t XmlPullReader::GetLineNumber() const {
+	std::size_t const end = std::min(m_tokenStart, m_input.size());
+	std::size_t lines = 1;
+	for (std::size_t i = 0; i < end; ++i) {
+		if (m_input[i] == '\n') ++lines;
+	}
+	return lines;
+}
+
+std::size_t XmlPullReader::GetColumnNumber() const {
+	std::size_t const end = std::min(m_tokenStart, m_input.size());
+	auto const lineStart = m_input.rfind('\n', end == 0 ? 0 : end - 1);
+	if (lineStart == std::string_view::npos || end == 0) return end + 1;
+	return end - lineStart;
+}
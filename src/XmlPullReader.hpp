@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A minimal, non-validating pull tokenizer for XML documents that are held in memory as a whole
+// (e.g. through MappedFileString). All names and texts handed out are views into the input buffer,
+// so tokenizing does not allocate.
+// Limitations: Entities are not decoded and whitespace-only text between elements is skipped.
+class XmlPullReader {
+public:
+	enum class Token {
+		StartElement,
+		EndElement,
+		Text,
+		EndOfDocument,
+		Error
+	};
+
+	XmlPullReader(std::string_view input);
+
+	Token ReadNext();
+
+	inline Token GetToken() const {
+		return m_token;
+	}
+	// Name of the current element, including a namespace prefix if there is one.
+	inline std::string_view GetQualifiedName() const {
+		return m_name;
+	}
+	// Name of the current element, with a namespace prefix (e.g. "ns3:") removed.
+	std::string_view GetName() const;
+	inline std::string_view GetText() const {
+		return m_text;
+	}
+	std::optional<std::string_view> GetAttribute(std::string_view name) const;
+
+	// Has to be called on a StartElement. Reads up to and including the matching EndElement and returns the trimmed text content.
+	// Fails (returning nullopt) if the element contains child elements or mixed content.
+	std::optional<std::string_view> ReadElementText();
+	// Has to be called on a StartElement. Reads up to and including the matching EndElement, ignoring everything in between.
+	bool SkipCurrentElement();
+
+	inline std::size_t GetDepth() const {
+		return m_openElements.size();
+	}
+	// Byte offset in the input where the current token started.
+	inline std::size_t GetTokenOffset() const {
+		return m_tokenStart;
+	}
+	// Byte offset in the input where the next token will start.
+	inline std::size_t GetPosition() const {
+		return m_position;
+	}
+	// True if the current StartElement was self-closing, i.e. the next token is its EndElement.
+	inline bool IsEmptyElement() const {
+		return m_pendingSelfCloseEnd;
+	}
+	// Continues tokenizing at the given byte offset, skipping everything up to there without looking at it.
+	// The offset has to point to markup directly within the current element (e.g. its end tag), as the open elements are not updated.
+	void SkipTo(std::size_t offset);
+	// Line and column of the current token, computed on demand as they are only needed for error reporting.
+	std::size_t GetLineNumber() const;
+	std::size_t GetColumnNumber() const;
+	inline std::string const& GetErrorMessage() const {
+		return m_errorMessage;
+	}
+
+	static bool NameEquals(std::string_view a, std::string_view b);
+	static std::string_view Trim(std::string_view s);
+private:
+	std::string_view const m_input;
+	std::size_t m_position = 0;
+	std::size_t m_tokenStart = 0;
+
+	Token m_token = Token::Error;
+	std::string_view m_name;
+	std::string_view m_text;
+	std::string_view m_attributes;
+	bool m_pendingSelfCloseEnd = false;
+	std::vector<std::string_view> m_openElements;
+	std::string m_errorMessage;
+
+	Token SetError(std::string const& message);
+	bool SkipPast(std::string_view terminator);
+};
@@ -0,0 +1,409 @@
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "ActivityIndex.hpp"
+#include "ActivitySummary.hpp"
+#include "BatchLoader.hpp"
+#include "DerivedSeries.hpp"
+#include "FastDecode.hpp"
+#include "Parser.hpp"
+#include "Trace.hpp"
+
+// Headless batch processing of TCX files: parses every given file (directories are searched recursively),
+// derives the same series as the viewer and writes one line of summary statistics per activity as CSV.
+
+struct CliOptions {
+	std::vector<std::filesystem::path> inputs;
+	std::filesystem::path summaryFile;
+	std::filesystem::path seriesDirectory;
+	std::filesystem::path traceFile;
+	DerivationOptions derivationOptions;
+	ParserBackend backend = ParserBackend::Streaming;
+	std::size_t threadCount = 0;
+	bool useTrackCache = false;
+	bool onlyBuildCaches = false;
+	bool doDebugOutput = false;
+};
+
+static void PrintUsage(char const* executable) {
+	std::cout << "Usage: " << executable << " [options] <file or directory>..." << std::endl;
+	std::cout << "Parses TCX files (directories are searched recursively) and writes summary statistics as CSV." << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -o, --output <file>     Write the summary CSV to <file> instead of stdout." << std::endl;
+	std::cout << "  -s, --series <dir>      Additionally write the derived series of every activity as CSV into <dir>, in the same subdirectories as the TCX files." << std::endl;
+	std::cout << "  -w, --window <n>        Window size of all filters in samples (default: 1)." << std::endl;
+	std::cout << "  -f, --filter <type>     Filter of the smoothed series: average, exponential, gaussian, median or savitzky-golay (default: average)." << std::endl;
+	std::cout << "      --speed <source>    Derive speed from: distance (as recorded), gps (positions) or smoothed-gps (default: distance)." << std::endl;
+	std::cout << "  -i, --interval <ms>     Resample every track to one sample per <ms> milliseconds before deriving the series (default: 1000)." << std::endl;
+	std::cout << "      --max-gap <ms>      Do not interpolate between samples more than <ms> milliseconds apart (default: 10000)." << std::endl;
+	std::cout << "  -j, --jobs <n>          Number of files to parse in parallel (default: one per hardware thread)." << std::endl;
+	std::cout << "  -c, --cache             Read tracks from their cache files (<file>.tcxcache) where up to date, write them for the others." << std::endl;
+	std::cout << "      --build-cache       Only write missing or outdated cache files, e.g. for a whole archive, no CSV output." << std::endl;
+	std::cout << "      --dom               Use the DOM based parser instead of the streaming one." << std::endl;
+	std::cout << "      --trace <file>      Write the timings of all processing stages as Chrome trace JSON to <file>." << std::endl;
+	std::cout << "  -v, --verbose           Print debug output of the parser." << std::endl;
+	std::cout << "  -h, --help              Show this help." << std::endl;
+}
+
+struct InputFile {
+	std::filesystem::path file;
+	// Relative to the given directory the file was found in, only the file name for files given directly
+	std::filesystem::path relativePath;
+};
+
+// Directories that can not be searched (completely) are reported and counted in failedDirectories, the files found in them are still processed.
+static std::vector<InputFile> CollectInputFiles(std::vector<std::filesystem::path> const& inputs, std::size_t& failedDirectories) {
+	std::vector<InputFile> result;
+	for (auto const& input : inputs) {
+		// Inputs that are not directories (or can not even be checked) are treated as files, so failing to read them is reported like for any other file
+		std::error_code error;
+		if (std::filesystem::is_directory(input, error)) {
+			for (auto const& file : ActivityIndex::FindTcxFiles(input, error)) {
+				result.push_back({ file, file.lexically_relative(input) });
+			}
+			if (error) {
+				std::cerr << "Error: Failed to search '" << input.string() << "' for TCX files: " << error.message() << std::endl;
+				++failedDirectories;
+			}
+		}
+		else {
+			result.push_back({ input, input.filename() });
+		}
+	}
+	return result;
+}
+
+// The series files mirror the directories below the given ones, so files of the same name in different directories do not overwrite each other.
+// Files that would still end up in the same series file (e.g. from two given directories) get a numbered one, which is reported.
+static std::vector<std::filesystem::path> GetSeriesFiles(std::vector<InputFile> const& inputFiles, std::filesystem::path const& seriesDirectory) {
+	std::vector<std::filesystem::path> result;
+	std::set<std::filesystem::path> usedNames;
+	for (auto const& inputFile : inputFiles) {
+		std::filesystem::path name = std::filesystem::path(inputFile.relativePath).replace_extension(".csv");
+		if (usedNames.contains(name)) {
+			std::filesystem::path const stem = name.parent_path() / name.stem();
+			for (std::size_t number = 2; usedNames.contains(name); ++number) {
+				name = stem;
+				name += "-" + std::to_string(number) + ".csv";
+			}
+			std::cerr << "Warning: The series of '" << inputFile.file.string() << "' is written to '" << (seriesDirectory / name).string() << "', another file has the same name." << std::endl;
+		}
+		usedNames.insert(name);
+		result.push_back(seriesDirectory / name);
+	}
+	return result;
+}
+
+static void WriteValue(std::ostream& out, double value) {
+	if (!std::isnan(value)) {
+		out << value;
+	}
+}
+
+static void WriteSummaryHeader(std::ostream& out) {
+	out << "file,trackpoints,start_time,duration_s,distance_m,moving_speed_mps,moving_pace_min_per_km,avg_heart_rate_bpm,max_heart_rate_bpm" << std::endl;
+}
+
+// Quoted CSV field, quotes within the text are doubled
+static void WriteQuoted(std::ostream& out, std::string const& text) {
+	out << '"';
+	for (char const character : text) {
+		if (character == '"') out << '"';
+		out << character;
+	}
+	out << '"';
+}
+
+static void WriteSummaryLine(std::ostream& out, std::filesystem::path const& file, ActivitySummary const& summary) {
+	WriteQuoted(out, file.string());
+	out << ',' << summary.trackpoints << ',';
+	if (summary.trackpoints > 0) out << EncodeIsoTimestamp(summary.startTimeMs);
+	out << ',';
+	WriteValue(out, summary.durationSeconds);
+	out << ',';
+	WriteValue(out, summary.distanceMeters);
+	out << ',';
+	WriteValue(out, summary.movingSpeedMetersPerSecond);
+	out << ',';
+	WriteValue(out, summary.movingPaceMinutesPerKilometer);
+	out << ',';
+	WriteValue(out, summary.avgHeartRateBpm);
+	out << ',';
+	WriteValue(out, summary.maxHeartRateBpm);
+	out << std::endl;
+}
+
+// Returns false if the file could not be written, which is reported.
+static bool WriteSeries(std::filesystem::path const& outputFile, DerivedSeries const& derivedSeries) {
+	// If this fails, so does opening the file, which is reported below
+	std::error_code error;
+	std::filesystem::create_directories(outputFile.parent_path(), error);
+	std::ofstream out(outputFile);
+	if (!out) {
+		std::cerr << "Error: Failed to open '" << outputFile.string() << "' for writing!" << std::endl;
+		return false;
+	}
+	out << std::fixed << std::setprecision(4);
+
+	static constexpr SeriesColumn COLUMNS[] = { SeriesColumn::Speed, SeriesColumn::AvgSpeed, SeriesColumn::AvgHeartRate, SeriesColumn::Pace, SeriesColumn::AvgPace, SeriesColumn::SpeedKmh, SeriesColumn::AvgSpeedKmh };
+	out << "time,speed_mps,avg_speed_mps,avg_heart_rate_bpm,pace_min_per_km,avg_pace_min_per_km,speed_kmh,avg_speed_kmh" << std::endl;
+	auto const& timeMs = derivedSeries.GetResampledTrack().GetTimeMs();
+	for (std::size_t i = 0; i < derivedSeries.Size(); ++i) {
+		out << EncodeIsoTimestamp(timeMs[i]);
+		for (auto const column : COLUMNS) {
+			out << ',';
+			WriteValue(out, derivedSeries.GetColumn(column)[i]);
+		}
+		out << '\n';
+	}
+	out.close();
+	if (!out) {
+		std::cerr << "Error: Failed to write '" << outputFile.string() << "'!" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static void WriteTrace(std::filesystem::path const& traceFile) {
+	if (traceFile.empty()) return;
+	try {
+		Trace::WriteChromeJson(traceFile);
+	}
+	catch (std::exception const& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+	}
+}
+
+static bool DecodeFilterType(std::string const& text, FilterType& filterType) {
+	static constexpr std::pair<char const*, FilterType> FILTER_TYPES[] = {
+		{ "average", FilterType::MovingAverage },
+		{ "exponential", FilterType::Exponential },
+		{ "gaussian", FilterType::Gaussian },
+		{ "median", FilterType::Median },
+		{ "savitzky-golay", FilterType::SavitzkyGolay },
+	};
+	for (auto const& [name, type] : FILTER_TYPES) {
+		if (text == name) {
+			filterType = type;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ParseArguments(int argc, char* argv[], CliOptions& options) {
+	int windowSize = 1;
+	FilterType filterType = FilterType::MovingAverage;
+	for (int i = 1; i < argc; ++i) {
+		std::string const argument = argv[i];
+		bool const hasValue = (i + 1) < argc;
+		if (argument == "-h" || argument == "--help") {
+			return false;
+		}
+		else if ((argument == "-o" || argument == "--output") && hasValue) {
+			options.summaryFile = argv[++i];
+		}
+		else if ((argument == "-s" || argument == "--series") && hasValue) {
+			options.seriesDirectory = argv[++i];
+		}
+		else if ((argument == "-w" || argument == "--window") && hasValue) {
+			if (!DecodeInteger(argv[++i], windowSize) || windowSize < 1) {
+				std::cerr << "Error: Invalid window size '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+		}
+		else if ((argument == "-f" || argument == "--filter") && hasValue) {
+			if (!DecodeFilterType(argv[++i], filterType)) {
+				std::cerr << "Error: Unknown filter '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+		}
+		else if (argument == "--speed" && hasValue) {
+			std::string const source = argv[++i];
+			if (source == "distance") {
+				options.derivationOptions.speedSource = SpeedSource::Distance;
+			}
+			else if (source == "gps") {
+				options.derivationOptions.speedSource = SpeedSource::Positions;
+			}
+			else if (source == "smoothed-gps") {
+				options.derivationOptions.speedSource = SpeedSource::SmoothedPositions;
+			}
+			else {
+				std::cerr << "Error: Unknown speed source '" << source << "'!" << std::endl;
+				return false;
+			}
+		}
+		else if ((argument == "-i" || argument == "--interval") && hasValue) {
+			int intervalMs = 0;
+			if (!DecodeInteger(argv[++i], intervalMs) || intervalMs < 1) {
+				std::cerr << "Error: Invalid resampling interval '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+			options.derivationOptions.resample.intervalMs = intervalMs;
+		}
+		else if (argument == "--max-gap" && hasValue) {
+			int maxGapMs = 0;
+			if (!DecodeInteger(argv[++i], maxGapMs) || maxGapMs < 0) {
+				std::cerr << "Error: Invalid maximum gap '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+			options.derivationOptions.resample.maxGapMs = maxGapMs;
+		}
+		else if ((argument == "-j" || argument == "--jobs") && hasValue) {
+			int threadCount = 0;
+			if (!DecodeInteger(argv[++i], threadCount) || threadCount < 1) {
+				std::cerr << "Error: Invalid number of jobs '" << argv[i] << "'!" << std::endl;
+				return false;
+			}
+			options.threadCount = static_cast<std::size_t>(threadCount);
+		}
+		else if (argument == "-c" || argument == "--cache") {
+			options.useTrackCache = true;
+		}
+		else if (argument == "--build-cache") {
+			options.useTrackCache = true;
+			options.onlyBuildCaches = true;
+		}
+		else if (argument == "--trace" && hasValue) {
+			options.traceFile = argv[++i];
+		}
+		else if (argument == "--dom") {
+			options.backend = ParserBackend::Dom;
+		}
+		else if (argument == "-v" || argument == "--verbose") {
+			options.doDebugOutput = true;
+		}
+		else if (!argument.empty() && argument.front() == '-') {
+			std::cerr << "Error: Unknown or incomplete option '" << argument << "'!" << std::endl;
+			return false;
+		}
+		else {
+			options.inputs.push_back(argument);
+		}
+	}
+
+	// The viewer offers cutoffs up to 250, so use the same range here
+	for (SeriesOptions* seriesOptions : { &options.derivationOptions.avgSpeed, &options.derivationOptions.avgSpeedKmh, &options.derivationOptions.heartRate, &options.derivationOptions.pace }) {
+		seriesOptions->filterType = filterType;
+		seriesOptions->windowSize = windowSize;
+		seriesOptions->cutoffMin = 0.0;
+		seriesOptions->cutoffMax = 250.0;
+	}
+	return !options.inputs.empty();
+}
+
+int main(int argc, char* argv[]) {
+	CliOptions options;
+	if (!ParseArguments(argc, argv, options)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	Trace::SetEnabled(!options.traceFile.empty());
+
+	std::ofstream summaryFile;
+	if (!options.summaryFile.empty()) {
+		summaryFile.open(options.summaryFile);
+		if (!summaryFile) {
+			std::cerr << "Error: Failed to open '" << options.summaryFile.string() << "' for writing!" << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& summaryOut = options.summaryFile.empty() ? std::cout : summaryFile;
+	summaryOut << std::fixed << std::setprecision(3);
+	if (!options.seriesDirectory.empty()) {
+		std::error_code error;
+		std::filesystem::create_directories(options.seriesDirectory, error);
+		if (error) {
+			std::cerr << "Error: Failed to create '" << options.seriesDirectory.string() << "': " << error.message() << std::endl;
+			return 1;
+		}
+	}
+
+	std::size_t failedDirectories = 0;
+	auto const inputFiles = CollectInputFiles(options.inputs, failedDirectories);
+	std::vector<std::filesystem::path> files;
+	for (auto const& inputFile : inputFiles) {
+		files.push_back(inputFile.file);
+	}
+	BatchLoader const loader(options.threadCount, 0, options.useTrackCache);
+	if (options.doDebugOutput) std::cerr << "Processing " << files.size() << " files on " << loader.GetThreadCount() << " threads." << std::endl;
+
+	if (options.onlyBuildCaches) {
+		std::size_t upToDate = 0;
+		std::size_t written = 0;
+		std::size_t failed = 0;
+		std::size_t writeFailed = 0;
+		loader.Load(files, options.doDebugOutput, options.backend, [&](BatchResult&& result) {
+			if (!result.track.has_value()) {
+				std::cerr << "Error: Failed to parse '" << result.file.string() << "': " << result.errorMessage << std::endl;
+				++failed;
+			}
+			else if (result.wasCached) {
+				++upToDate;
+			}
+			else if (!result.cacheErrorMessage.empty()) {
+				std::cerr << "Error: Failed to write the cache of '" << result.file.string() << "': " << result.cacheErrorMessage << std::endl;
+				++writeFailed;
+			}
+			else {
+				++written;
+			}
+		});
+		std::cout << written << " caches written, " << upToDate << " already up to date, " << failed << " files failed to parse, " << writeFailed << " caches failed to write." << std::endl;
+		if (failedDirectories > 0) {
+			std::cerr << failedDirectories << " of the given directories could not be searched completely." << std::endl;
+		}
+		WriteTrace(options.traceFile);
+		return (failed > 0 || writeFailed > 0 || failedDirectories > 0) ? 1 : 0;
+	}
+
+	std::vector<std::filesystem::path> seriesFiles;
+	if (!options.seriesDirectory.empty()) {
+		seriesFiles = GetSeriesFiles(inputFiles, options.seriesDirectory);
+	}
+	WriteSummaryHeader(summaryOut);
+	DerivedSeries derivedSeries;
+	std::size_t failedFiles = 0;
+	// Parsing runs on the worker threads, the (much cheaper) derivations and all output happen here in input order
+	loader.Load(files, options.doDebugOutput, options.backend, [&](BatchResult&& result) {
+		if (!result.track.has_value()) {
+			std::cerr << "Error: Failed to parse '" << result.file.string() << "': " << result.errorMessage << std::endl;
+			++failedFiles;
+			return;
+		}
+		Track const& track = result.track.value();
+		try {
+			derivedSeries.Compute(track, options.derivationOptions);
+		}
+		catch (std::exception const& e) {
+			std::cerr << "Error: Failed to process '" << result.file.string() << "': " << e.what() << std::endl;
+			++failedFiles;
+			return;
+		}
+
+		WriteSummaryLine(summaryOut, result.file, ComputeActivitySummary(track, derivedSeries));
+		if (!options.seriesDirectory.empty() && !WriteSeries(seriesFiles[result.index], derivedSeries)) {
+			++failedFiles;
+		}
+	});
+	WriteTrace(options.traceFile);
+
+	if (failedFiles > 0) {
+		std::cerr << failedFiles << " of " << files.size() << " files could not be processed." << std::endl;
+	}
+	if (failedDirectories > 0) {
+		std::cerr << failedDirectories << " of the given directories could not be searched completely." << std::endl;
+	}
+	return (failedFiles > 0 || failedDirectories > 0) ? 1 : 0;
+}
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "SeriesFilters.hpp"
+#include "SeriesKernels.hpp"
+
+// Checks the filters against straightforward reference implementations (the algorithms they replaced) on random series
+// with gaps, for several window sizes and cutoffs, and the Gaussian, which is approximated by box filters, against a true Gaussian.
+// Exits with 1 if any result differs by more than rounding, or the Gaussian by more than its bound.
+
+static double const MISSING = std::numeric_limits<double>::quiet_NaN();
+
+// Values between 0 and 200, the given percentage of them missing.
+static std::vector<double> GenerateValues(std::size_t count, std::uint32_t missingPercent, std::uint32_t seed) {
+	std::vector<double> result(count);
+	std::uint32_t random = seed;
+	for (auto& value : result) {
+		random = random * 1664525u + 1013904223u;
+		value = ((random >> 8) % 100 < missingPercent) ? MISSING : static_cast<double>((random >> 12) % 20000) / 100.0;
+	}
+	return result;
+}
+
+// The moving average as computed before the sliding window, summing up the whole window for every output.
+static void ReferenceMovingAverage(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	for (std::size_t i = 0; i < input.size(); ++i) {
+		double sum = 0.0;
+		std::size_t summands = 0;
+		std::size_t lastExistingIndex = i;
+		for (std::size_t j = 0; j < windowSize; ++j) {
+			if (i + j < input.size()) lastExistingIndex = i + j;
+			double const value = input[lastExistingIndex];
+			if (value >= cutoffMin && value <= cutoffMax) {
+				sum += value;
+				++summands;
+			}
+		}
+		output[i] = (summands > 0) ? sum / static_cast<double>(summands) : MISSING;
+	}
+}
+
+// The exponential moving average as explicitly weighted sum of the valid values since the last gap of a window size or more,
+// newest first: a, a (1 - a), a (1 - a)^2, ..., and (1 - a)^m for the oldest one, which starts the average.
+static void ReferenceExponential(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	double const alpha = 2.0 / (static_cast<double>(windowSize) + 1.0);
+	for (std::size_t i = 0; i < input.size(); ++i) {
+		std::vector<double> values;
+		std::size_t invalidCount = 0;
+		for (std::size_t j = i + 1; j-- > 0 && windowSize > 0 && invalidCount < windowSize;) {
+			if (input[j] >= cutoffMin && input[j] <= cutoffMax) {
+				values.push_back(input[j]);
+				invalidCount = 0;
+			}
+			else {
+				++invalidCount;
+			}
+		}
+		if (values.empty()) {
+			output[i] = MISSING;
+			continue;
+		}
+		double sum = 0.0;
+		double weight = alpha;
+		for (std::size_t k = 0; k + 1 < values.size(); ++k) {
+			sum += weight * values[k];
+			weight *= 1.0 - alpha;
+		}
+		output[i] = sum + (weight / alpha) * values.back();
+	}
+}
+
+// The median by sorting the valid values of every window, see SeriesFilter::applyMedian() for the window.
+static void ReferenceMedian(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	std::size_t const before = (windowSize > 0) ? (windowSize - 1) / 2 : 0;
+	std::size_t const after = windowSize / 2;
+	std::vector<double> window;
+	for (std::size_t i = 0; i < input.size(); ++i) {
+		window.clear();
+		if (windowSize > 0) {
+			for (std::size_t j = (i >= before) ? i - before : 0; j <= i + after && j < input.size(); ++j) {
+				if (input[j] >= cutoffMin && input[j] <= cutoffMax) window.push_back(input[j]);
+			}
+		}
+		std::sort(window.begin(), window.end());
+		std::size_t const count = window.size();
+		if (count == 0) output[i] = MISSING;
+		else if (count % 2 == 1) output[i] = window[count / 2];
+		else output[i] = (window[count / 2 - 1] + window[count / 2]) / 2.0;
+	}
+}
+
+// The Savitzky-Golay filter by setting up and solving the normal equations of the quadratic fit for every window, see
+// SeriesFilter::applySavitzkyGolay() for the window and the fallback to the mean.
+static void ReferenceSavitzkyGolay(std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+	std::size_t const half = windowSize / 2;
+	auto const isValid = [cutoffMin, cutoffMax](double value) {
+		return value >= cutoffMin && value <= cutoffMax;
+	};
+	for (std::size_t i = 0; i < input.size(); ++i) {
+		if (windowSize == 0) {
+			output[i] = MISSING;
+			continue;
+		}
+		if (half == 0) {
+			output[i] = isValid(input[i]) ? input[i] : MISSING;
+			continue;
+		}
+		// Augmented matrix of the normal equations for a + b x + c x^2 with x = offset / half
+		double matrix[3][4] = {};
+		std::size_t count = 0;
+		double sum = 0.0;
+		for (std::size_t j = (i >= half) ? i - half : 0; j <= i + half && j < input.size(); ++j) {
+			if (!isValid(input[j])) continue;
+			double const x = (static_cast<double>(j) - static_cast<double>(i)) / static_cast<double>(half);
+			double const powers[5] = { 1.0, x, x * x, x * x * x, x * x * x * x };
+			for (int row = 0; row < 3; ++row) {
+				for (int column = 0; column < 3; ++column) matrix[row][column] += powers[row + column];
+				matrix[row][3] += powers[row] * input[j];
+			}
+			++count;
+			sum += input[j];
+		}
+		if (count == 0) {
+			output[i] = MISSING;
+			continue;
+		}
+		if (!isValid(input[i]) || count < 3) {
+			output[i] = sum / static_cast<double>(count);
+			continue;
+		}
+		// Gaussian elimination with partial pivoting, then back substitution down to the constant coefficient
+		for (int pivot = 0; pivot < 3; ++pivot) {
+			int best = pivot;
+			for (int row = pivot + 1; row < 3; ++row) {
+				if (std::abs(matrix[row][pivot]) > std::abs(matrix[best][pivot])) best = row;
+			}
+			for (int column = 0; column < 4; ++column) std::swap(matrix[pivot][column], matrix[best][column]);
+			for (int row = pivot + 1; row < 3; ++row) {
+				double const factor = matrix[row][pivot] / matrix[pivot][pivot];
+				for (int column = pivot; column < 4; ++column) matrix[row][column] -= factor * matrix[pivot][column];
+			}
+		}
+		double coefficients[3];
+		for (int row = 2; row >= 0; --row) {
+			double value = matrix[row][3];
+			for (int column = row + 1; column < 3; ++column) value -= matrix[row][column] * coefficients[column];
+			coefficients[row] = value / matrix[row][row];
+		}
+		output[i] = coefficients[0];
+	}
+}
+
+static bool IsClose(double value, double reference, double tolerance) {
+	if (std::isnan(value) || std::isnan(reference)) return std::isnan(value) && std::isnan(reference);
+	return std::abs(value - reference) <= tolerance * std::max(1.0, std::abs(reference));
+}
+
+struct Filter {
+	char const* name;
+	// Relative to the magnitude of the values, the sliding window sums round differently than summing up every window
+	double tolerance;
+	std::function<void(std::span<double const>, std::size_t, double, double, std::span<double>)> reference;
+	std::function<void(std::span<double const>, std::size_t, double, double, std::span<double>)> tested;
+};
+
+// The Gaussian filter runs three box filters, whose combined kernel only approximates a Gaussian. Compares that kernel (the response to a
+// single valid sample of 1 among zeros) with the Gaussian of the window, truncated at +-3 standard deviations and normalized. Half the L1 distance
+// of the kernels bounds how far the result on a series without gaps can be off, as a share of the range of its values.
+// Windows below 12 samples (a standard deviation of 2) are not checked, their boxes are only one to three samples wide.
+static std::size_t CheckGaussianKernel(SeriesFilter& seriesFilter) {
+	static constexpr double MAX_KERNEL_DISTANCE = 0.1;
+	std::size_t mismatches = 0;
+	for (std::size_t const windowSize : { 12, 13, 20, 30, 61, 101, 300, 1001, 5000 }) {
+		std::size_t const size = 2 * windowSize + 101;
+		std::size_t const center = size / 2;
+		std::vector<double> input(size, 0.0);
+		input[center] = 1.0;
+		std::vector<double> kernel(size);
+		SeriesOptions options;
+		options.filterType = FilterType::Gaussian;
+		options.windowSize = static_cast<int>(windowSize);
+		options.cutoffMin = -std::numeric_limits<double>::infinity();
+		options.cutoffMax = std::numeric_limits<double>::infinity();
+		seriesFilter.Apply(input, options, kernel);
+
+		double const sigma = static_cast<double>(windowSize) / 6.0;
+		double const half = static_cast<double>(windowSize / 2);
+		auto const gaussian = [&](double k) {
+			return (std::abs(k) <= half) ? std::exp(-k * k / (2.0 * sigma * sigma)) : 0.0;
+		};
+		double norm = 0.0;
+		for (std::size_t i = 0; i < size; ++i) {
+			norm += gaussian(static_cast<double>(i) - static_cast<double>(center));
+		}
+		double distance = 0.0;
+		for (std::size_t i = 0; i < size; ++i) {
+			distance += std::abs(kernel[i] - gaussian(static_cast<double>(i) - static_cast<double>(center)) / norm);
+		}
+		if (!(distance <= MAX_KERNEL_DISTANCE)) {
+			std::cout << "Gaussian kernel of window " << windowSize << " is " << distance << " away from a true Gaussian (L1), more than " << MAX_KERNEL_DISTANCE << "." << std::endl;
+			++mismatches;
+		}
+	}
+	return mismatches;
+}
+
+int main() {
+	// One instance for all checks, so they also cover the reuse of its buffers
+	SeriesFilter seriesFilter;
+	auto const applyFilter = [&seriesFilter](FilterType filterType) {
+		return [&seriesFilter, filterType](std::span<double const> input, std::size_t windowSize, double cutoffMin, double cutoffMax, std::span<double> output) {
+			SeriesOptions options;
+			options.filterType = filterType;
+			options.windowSize = static_cast<int>(windowSize);
+			options.cutoffMin = cutoffMin;
+			options.cutoffMax = cutoffMax;
+			seriesFilter.Apply(input, options, output);
+		};
+	};
+	std::vector<Filter> const filters = {
+		{ "Moving average", 1e-9, ReferenceMovingAverage, MovingAverage },
+		{ "Exponential", 1e-9, ReferenceExponential, applyFilter(FilterType::Exponential) },
+		{ "Median", 0.0, ReferenceMedian, applyFilter(FilterType::Median) },
+		{ "Savitzky-Golay", 1e-6, ReferenceSavitzkyGolay, applyFilter(FilterType::SavitzkyGolay) },
+	};
+	std::vector<std::size_t> const counts = { 0, 1, 5, 1000, 3000 };
+	std::vector<std::uint32_t> const missingPercents = { 0, 5, 50, 100 };
+	std::vector<std::size_t> const windowSizes = { 0, 1, 2, 3, 7, 30, 101, 5000 };
+	struct Cutoff {
+		double min;
+		double max;
+	};
+	std::vector<Cutoff> const cutoffs = { { -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() }, { 50.0, 150.0 }, { 300.0, 400.0 } };
+
+	std::size_t checks = 0;
+	std::size_t mismatches = 0;
+	for (auto const& filter : filters) {
+		for (auto const count : counts) {
+			for (auto const missingPercent : missingPercents) {
+				std::vector<double> const input = GenerateValues(count, missingPercent, static_cast<std::uint32_t>(count * 101 + missingPercent));
+				for (auto const windowSize : windowSizes) {
+					for (auto const& cutoff : cutoffs) {
+						std::vector<double> expected(count);
+						std::vector<double> actual(count);
+						filter.reference(input, windowSize, cutoff.min, cutoff.max, expected);
+						filter.tested(input, windowSize, cutoff.min, cutoff.max, actual);
+						++checks;
+						for (std::size_t i = 0; i < count; ++i) {
+							if (IsClose(actual[i], expected[i], filter.tolerance)) continue;
+							std::cout << filter.name << " differs: " << count << " samples, " << missingPercent << "% missing, window " << windowSize
+								<< ", cutoff [" << cutoff.min << ", " << cutoff.max << "], sample " << i << ": " << actual[i] << " instead of " << expected[i] << std::endl;
+							++mismatches;
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+	mismatches += CheckGaussianKernel(seriesFilter);
+	std::cout << checks << " checks, " << mismatches << " mismatches." << std::endl;
+	return (mismatches > 0) ? 1 : 0;
+}